@@ -0,0 +1,50 @@
+/*
+ ==============================================================================
+
+ AllocationChecker.cpp
+
+ ==============================================================================
+ */
+
+#include "AllocationChecker.h"
+
+#if MICROMOD_CHECK_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace allocation_checker
+{
+static thread_local int noAllocationDepth = 0;
+static std::atomic<int> numAllocations { 0 };
+
+ScopedNoAllocations::ScopedNoAllocations() { noAllocationDepth++; }
+ScopedNoAllocations::~ScopedNoAllocations() { noAllocationDepth--; }
+
+int getNumAllocations() { return numAllocations.load(); }
+
+static void* allocate(std::size_t size)
+{
+    if(noAllocationDepth > 0)
+    {
+        numAllocations++;
+        //jassert may allocate while logging, so stop checking until it returns.
+        const int depth = noAllocationDepth;
+        noAllocationDepth = 0;
+        jassertfalse; // something allocated on the audio thread!
+        noAllocationDepth = depth;
+    }
+    if(void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+} // end namespace allocation_checker
+
+void* operator new(std::size_t size) { return allocation_checker::allocate(size); }
+void* operator new[](std::size_t size) { return allocation_checker::allocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+#endif
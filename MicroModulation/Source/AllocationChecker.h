@@ -0,0 +1,46 @@
+/*
+ ==============================================================================
+
+ AllocationChecker.h
+
+ A debugging aid for checking that the audio thread never allocates.
+ When MICROMOD_CHECK_ALLOCATIONS is enabled, AllocationChecker.cpp replaces the global operator new/delete,
+ and any allocation made while a ScopedNoAllocations object is alive on the same thread hits a jassert.
+ When it is disabled, everything here compiles to nothing.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#ifndef MICROMOD_CHECK_ALLOCATIONS
+ #define MICROMOD_CHECK_ALLOCATIONS 0
+#endif
+
+namespace allocation_checker
+{
+#if MICROMOD_CHECK_ALLOCATIONS
+/**
+ While an object of this class is alive, any heap allocation on the current thread hits a jassert,
+ and is counted by getNumAllocations().
+ */
+struct ScopedNoAllocations
+{
+    ScopedNoAllocations();
+    ~ScopedNoAllocations();
+    JUCE_DECLARE_NON_COPYABLE(ScopedNoAllocations)
+};
+/**
+ @return The number of allocations that have happened inside of a ScopedNoAllocations, on any thread.
+ */
+int getNumAllocations();
+#endif
+} // end namespace allocation_checker
+
+#if MICROMOD_CHECK_ALLOCATIONS
+ #define MICROMOD_SCOPED_NO_ALLOCATIONS const allocation_checker::ScopedNoAllocations JUCE_JOIN_MACRO(noAllocations_, __LINE__)
+#else
+ #define MICROMOD_SCOPED_NO_ALLOCATIONS
+#endif
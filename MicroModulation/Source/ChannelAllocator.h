@@ -0,0 +1,188 @@
+/*
+ ==============================================================================
+
+ ChannelAllocator.h
+
+ Assigns MPE member channels to new notes. This replaces juce::MPEChannelAssigner,
+ which keeps a juce::Array of notes per channel and can allocate on the audio thread.
+ All of the state here is stored in fixed size arrays, so it never allocates.
+
+ Channels are pooled by bend class: notes that need the same pitchbend can share one channel,
+ as long as they are different (output) note numbers. Tunings that only use a handful of distinct bends
+ (ex: subsets of 12/19/31/72-EDO) can then play far more than 15 notes at once, and a note that joins a channel
+ which already has the right bend doesn't need a pitch wheel message.
+ New bend classes get a free channel (preferring one that is already bent correctly, then round-robin).
+ If every channel is busy with other bends, the channel with the fewest notes is stolen (the one that has waited longest
+ for a new note, if several have as few). Its notes are released first, since they would go out of tune when it is bent.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <bitset>
+#include <cstdlib>
+
+#include "JuceHeader.h"
+
+class ChannelAllocator
+{
+public:
+    struct Assignment
+    {
+        int channel;             // the midi channel to play the note on
+        bool pitchWheelChanged;  // true if a pitch wheel message needs to be sent to channel before the note
+        bool notesReleased;      // true if channel was stolen from notes with another bend. They need note offs before the pitch wheel
+    };
+    static constexpr int unknownPitchWheel = -1;
+
+    ChannelAllocator() : ChannelAllocator(2, 16) {}
+    /**
+     @param firstChannel The first member channel that can be assigned, on [1, 16].
+     @param lastChannel The last member channel that can be assigned, on [firstChannel, 16].
+     */
+    ChannelAllocator(int firstChannel, int lastChannel) : poolByBend(true), bendTolerance(0), numAssignments(0)
+    {
+        setChannelRange(firstChannel, lastChannel);
+    }
+
+    /**
+     Sets which channels can be assigned, and releases all notes.
+     */
+    void setChannelRange(int newFirstChannel, int newLastChannel)
+    {
+        jassert(newFirstChannel >= 1 && newLastChannel <= 16 && newFirstChannel <= newLastChannel);
+        firstChannel = newFirstChannel;
+        lastChannel = newLastChannel;
+        resetPitchWheels();
+        allNotesOff();
+    }
+    /**
+     Forgets the pitch wheel of every channel, so that no new note shares a channel without bending it first.
+     */
+    void resetPitchWheels()
+    {
+        for(int ch = 0; ch <= maxChannel; ch++) channelPitchWheel[ch] = unknownPitchWheel;
+    }
+    void allNotesOff()
+    {
+        for(int ch = 0; ch <= maxChannel; ch++)
+        {
+            numNotes[ch] = 0;
+            notesOn[ch].reset();
+            lastAssignment[ch] = 0;
+        }
+        lastChannelAssigned = lastChannel;
+    }
+
+    /**
+     @param shouldPool If true, notes with the same bend share channels. If false, every channel only plays one note at a time (unless all channels are busy).
+     */
+    void setPoolByBend(bool shouldPool) { poolByBend = shouldPool; }
+    /**
+     @param pitchWheelSteps How far apart (in 14-bit pitch wheel steps) two bends can be while still being treated as the same bend class.
+     */
+    void setBendTolerance(int pitchWheelSteps) { bendTolerance = juce::jmax(0, pitchWheelSteps); }
+
+    /**
+     Finds a channel for a new note, and marks the note as playing on it.
+     @param noteNumber The (output) midi note number that will be played.
+     @param pitchWheel The 14-bit pitch wheel position that noteNumber needs.
+     @return The channel to play noteNumber on, and whether its pitch wheel has to be changed first.
+     */
+    Assignment findChannelForNewNote(int noteNumber, int pitchWheel)
+    {
+        if(poolByBend)
+        {
+            for(int ch = firstChannel; ch <= lastChannel; ch++)
+            {
+                if(numNotes[ch] > 0 && isSameBend(ch, pitchWheel) && !notesOn[ch][noteNumber]) return assign(ch, noteNumber, pitchWheel);
+            }
+        }
+        for(int ch = firstChannel; ch <= lastChannel; ch++)
+        {
+            if(numNotes[ch] == 0 && isSameBend(ch, pitchWheel)) return assign(ch, noteNumber, pitchWheel);
+        }
+        for(int ch = nextChannel(lastChannelAssigned); ; ch = nextChannel(ch))
+        {
+            if(numNotes[ch] == 0) return assign(ch, noteNumber, pitchWheel);
+            if(ch == lastChannelAssigned) break; // no free channels
+        }
+        int leastBusyChannel = firstChannel;
+        for(int ch = firstChannel; ch <= lastChannel; ch++)
+        {
+            if(numNotes[ch] < numNotes[leastBusyChannel]
+               || (numNotes[ch] == numNotes[leastBusyChannel] && lastAssignment[ch] < lastAssignment[leastBusyChannel])) leastBusyChannel = ch;
+        }
+        bool notesReleased = !isSameBend(leastBusyChannel, pitchWheel);
+        if(notesReleased)
+        {
+            numNotes[leastBusyChannel] = 0;
+            notesOn[leastBusyChannel].reset();
+        }
+        Assignment assignment = assign(leastBusyChannel, noteNumber, pitchWheel);
+        assignment.notesReleased = notesReleased;
+        return assignment;
+    }
+    /**
+     Marks a note as playing on a channel that was chosen outside of this class (ex: with a static channel layout).
+     */
+    Assignment assignToChannel(int channel, int noteNumber, int pitchWheel)
+    {
+        jassert(channel >= firstChannel && channel <= lastChannel);
+        return assign(channel, noteNumber, pitchWheel);
+    }
+    /**
+     Records a pitch wheel message that was sent to channel outside of findChannelForNewNote().
+     @param pitchWheel The position that was sent, or unknownPitchWheel so that no new note shares the channel without bending it first.
+     */
+    void setPitchWheel(int channel, int pitchWheel) { channelPitchWheel[channel] = pitchWheel; }
+    
+    /**
+     Releases a note that was assigned with findChannelForNewNote().
+     @param channel The channel noteNumber was assigned to.
+     @param noteNumber The (output) midi note number that stopped.
+     */
+    void noteOff(int channel, int noteNumber)
+    {
+        jassert(channel >= firstChannel && channel <= lastChannel);
+        if(numNotes[channel] > 0) numNotes[channel]--;
+        notesOn[channel][noteNumber] = false;
+    }
+
+    int getNumNotes(int channel) const { return numNotes[channel]; }
+    /**
+     @return The last pitch wheel position assigned to channel, or -1 if it hasn't been set.
+     */
+    int getPitchWheel(int channel) const { return channelPitchWheel[channel]; }
+
+private:
+    static constexpr int maxChannel = 16;
+    bool poolByBend;
+    int bendTolerance;
+    int firstChannel, lastChannel;
+    int lastChannelAssigned;
+    // all indexed by midi channel. index 0 is unused.
+    int numNotes[maxChannel + 1];
+    int channelPitchWheel[maxChannel + 1];
+    std::bitset<128> notesOn[maxChannel + 1]; // which output note numbers are playing on each channel
+    juce::int64 numAssignments;
+    juce::int64 lastAssignment[maxChannel + 1]; // numAssignments when each channel was last assigned a note, to find the oldest
+
+    int nextChannel(int ch) const { return ch >= lastChannel ? firstChannel : ch + 1; }
+    bool isSameBend(int ch, int pitchWheel) const
+    {
+        return channelPitchWheel[ch] != unknownPitchWheel && std::abs(channelPitchWheel[ch] - pitchWheel) <= bendTolerance;
+    }
+    Assignment assign(int ch, int noteNumber, int pitchWheel)
+    {
+        bool pitchWheelChanged = !isSameBend(ch, pitchWheel);
+        if(pitchWheelChanged) channelPitchWheel[ch] = pitchWheel;
+        // a stolen channel could already be playing noteNumber. it is only counted once, so that one note off releases it.
+        if(!notesOn[ch][noteNumber]) numNotes[ch]++;
+        notesOn[ch][noteNumber] = true;
+        lastChannelAssigned = ch;
+        lastAssignment[ch] = ++numAssignments;
+        return { ch, pitchWheelChanged, false };
+    }
+};
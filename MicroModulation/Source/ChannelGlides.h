@@ -0,0 +1,112 @@
+/*
+ ==============================================================================
+
+ ChannelGlides.h
+
+ Glides the member channels of held notes to a new pitch wheel position after a modulation.
+ Each glide sends at most one pitch wheel message per minTimeBetweenBends, so gliding every channel at once
+ can't flood the midi link. The settings are atomics, so they can be changed from the message thread,
+ and everything else is only used by the audio thread. Nothing here allocates.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+
+#include "JuceHeader.h"
+
+class ChannelGlides
+{
+public:
+    static constexpr double minIntervalMs = 1.0; // the fastest rate that buffers are sized for
+
+    /**
+     @param shouldRetune If true, notes that are held through a modulation glide to the new tuning.
+     */
+    void setRetuneHeldNotes(bool shouldRetune) { retuneHeldNotes.store(shouldRetune); }
+    bool isRetuningHeldNotes() const { return retuneHeldNotes.load(std::memory_order_relaxed); }
+    /**
+     @param milliseconds How long a glide takes. 0 sends the new pitch wheel position in the same block as the modulation.
+     */
+    void setGlideTime(float milliseconds) { glideTimeMs.store(juce::jmax(0.0f, milliseconds)); }
+    /**
+     @param milliseconds The shortest time between two pitch wheel messages on the same channel. Clamped to at least minIntervalMs.
+     */
+    void setMinTimeBetweenBends(float milliseconds) { minTimeBetweenBendsMs.store(juce::jmax(static_cast<float>(minIntervalMs), milliseconds)); }
+
+    void setSampleRate(double newSampleRate) { sampleRate = newSampleRate; }
+    /**
+     @return The most pitch wheel messages one channel can send in a block of numSamples, for sizing the output buffer.
+     */
+    int getMaxBendsPerChannel(int numSamples) const
+    {
+        return static_cast<int>(numSamples / (minIntervalMs * 0.001 * sampleRate)) + 1;
+    }
+
+    /**
+     Starts gliding channel from startPitchWheel to targetPitchWheel. A channel that is already gliding keeps its schedule,
+     so restarting its glide can't send bends any faster.
+     @param samplePosition Where in the current block the glide starts.
+     */
+    void start(int channel, int startPitchWheel, int targetPitchWheel, int samplePosition)
+    {
+        Glide& glide = glides[channel];
+        glide.nextBendSample = glide.isActive ? juce::jmax(glide.nextBendSample, samplePosition) : samplePosition;
+        glide.isActive = true;
+        glide.startPitchWheel = startPitchWheel;
+        glide.targetPitchWheel = targetPitchWheel;
+        glide.samplesElapsed = -samplePosition; // so the glide is timed from the modulation, not from the start of the block
+        glide.lengthInSamples = static_cast<int>(glideTimeMs.load(std::memory_order_relaxed) * 0.001 * sampleRate);
+    }
+    void stop(int channel) { glides[channel].isActive = false; }
+    void stopAll()
+    {
+        for(Glide& glide : glides) glide.isActive = false;
+    }
+
+    /**
+     Works out the pitch wheel messages of every active glide that fall inside this block, and moves on to the next block.
+     @param sendBend Called as sendBend(channel, pitchWheel, samplePosition, isFinished) for each message, in time order per channel.
+     */
+    template <typename SendBend>
+    void process(int numSamples, SendBend&& sendBend)
+    {
+        const int interval = juce::jmax(1, static_cast<int>(std::lround(minTimeBetweenBendsMs.load(std::memory_order_relaxed) * 0.001 * sampleRate)));
+        for(int channel = 1; channel <= 16; channel++)
+        {
+            Glide& glide = glides[channel];
+            if(!glide.isActive) continue;
+
+            while(glide.isActive && glide.nextBendSample < numSamples)
+            {
+                int t = glide.samplesElapsed + glide.nextBendSample;
+                bool isFinished = t >= glide.lengthInSamples;
+                int pitchWheel = isFinished ? glide.targetPitchWheel
+                    : glide.startPitchWheel + static_cast<int>(static_cast<juce::int64>(glide.targetPitchWheel - glide.startPitchWheel) * t / glide.lengthInSamples);
+                sendBend(channel, pitchWheel, glide.nextBendSample, isFinished);
+                glide.isActive = !isFinished;
+                glide.nextBendSample += interval;
+            }
+            glide.samplesElapsed += numSamples;
+            glide.nextBendSample = juce::jmax(0, glide.nextBendSample - numSamples);
+        }
+    }
+
+private:
+    struct Glide
+    {
+        bool isActive;
+        int startPitchWheel, targetPitchWheel;
+        int samplesElapsed; // since the glide started, at the start of the current block. Negative if it starts later in the block
+        int lengthInSamples;
+        int nextBendSample; // relative to the start of the current block
+    };
+
+    std::atomic<bool> retuneHeldNotes { false };
+    std::atomic<float> glideTimeMs { 0.0f }, minTimeBetweenBendsMs { 2.0f };
+    double sampleRate = 44100.0;
+    Glide glides[17] = {}; // indexed by midi channel
+};
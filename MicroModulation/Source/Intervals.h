@@ -0,0 +1,27 @@
+/*
+ ==============================================================================
+
+ Intervals.h
+
+ Conversions between the ways an interval can be written: cents, frequency ratios, and semitones.
+ Everything is in double precision, so an interval read from a .scl file keeps every digit it was written with.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <cmath>
+
+namespace intervals {
+
+/**
+ @return The frequency ratio of an interval, ex: 1200 cents is 2/1.
+ */
+inline double centsToRatio(double cents) { return std::exp2(cents / 1200.0); }
+/**
+ @return The size of a frequency ratio in semitones, ex: 3/2 is about 7.02 semitones.
+ */
+inline double ratioToSemitones(double ratio) { return 12.0 * std::log2(ratio); }
+
+}  // end namespace intervals
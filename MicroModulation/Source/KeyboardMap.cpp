@@ -1,196 +1,136 @@
-/*
- ==============================================================================
- 
- KeyboardMap.cpp
- Created: 23 May 2021 5:06:31pm
- Author:  Willow Weiner
- 
- ==============================================================================
- */
-
-#include <cstdio>
-#include <fstream>
-
-#include "JuceHeader.h"
-
-#include "Identifiers.h"  //stores all juce::Identifier s in namespace "IDs"
-#include "KeyboardMap.h"
-#include "utils.h"
-
-KeyboardMap::KeyboardMap(juce::UndoManager& um) : keyboardMapValues(IDs::keyboardMap), undoManager(um)
-{
-    setDefaultValues();
-}
-
-KeyboardMap::KeyboardMap(juce::UndoManager& um, int sclLength) : KeyboardMap(um) { setToDefaultMapping(sclLength); }
-KeyboardMap::KeyboardMap(juce::UndoManager& um, int sclLength, std::string kbmPath) : KeyboardMap(um)
-{
-    keyboardMapValues.setProperty(IDs::scaleLength, sclLength, &undoManager);
-    loadKbmFile(kbmPath);
-}
-
-void KeyboardMap::setDefaultValues()
-{
-    keyboardMapValues.setProperty(IDs::retuneRangeLowerBound,
-                                  (signed char) 0, &undoManager);
-    keyboardMapValues.setProperty(IDs::retuneRangeUpperBound,
-                                  (signed char) 127, &undoManager);
-    keyboardMapValues.setProperty(IDs::middleNote,
-                                  (signed char) 60, &undoManager);
-    keyboardMapValues.setProperty(IDs::referenceNote,
-                                  (signed char) 69, &undoManager);
-    keyboardMapValues.setProperty(IDs::referenceFreq,
-                                  440.f, &undoManager);
-    keyboardMapValues.setProperty(IDs::formalOctaveScaleDegree,
-                                  -1, &undoManager);
-    keyboardMapValues.setProperty(IDs::scaleLength,
-                                  -1, &undoManager);
-    keyboardMapValues.setProperty(IDs::keyboardMapping,
-                                  juce::Array<juce::var>(), &undoManager);
-}
-
-void KeyboardMap::setToDefaultMapping(int scaleLength)
-{
-    setDefaultValues();
-    keyboardMapValues.setProperty(IDs::scaleLength,
-                                  scaleLength, &undoManager);
-    keyboardMapValues.setProperty(IDs::formalOctaveScaleDegree,
-                                  scaleLength - 1, &undoManager);
-    for(int i = 0; i < scaleLength; i++)
-    {
-        getMapping().add(juce::var(i));
-    }
-}
-
-bool KeyboardMap::loadKbmFile(std::string kbmPath)
-{
-    std::ifstream kbmFile(kbmPath);
-    std::string line;
-    if(kbmFile.is_open())
-    {
-        undoManager.beginNewTransaction();
-        bool fileReadCorrectly = true;
-        getMapping().clear();
-        
-        try
-        {
-            int lineNum = 0;
-            int mappingSize;
-            while(getline(kbmFile, line))
-            {
-                line = utils::removeLineSpaceAndComments(line);
-                if(line != "") //if our line wasn't just a comment line
-                {
-                    switch(++lineNum)
-                    {
-                        case 1: //line = the size of map. after how many keys the pattern repeats.
-                            mappingSize = std::stoi(line);
-                            if(mappingSize <= 0 ) return false;
-                            break;
-                        case 2: //first midi note number to retune
-                            keyboardMapValues.setProperty(IDs::retuneRangeLowerBound, std::stoi(line), &undoManager);
-                            break;
-                        case 3: //last midi note number to retune
-                            keyboardMapValues.setProperty(IDs::retuneRangeUpperBound, std::stoi(line), &undoManager);
-                            break;
-                        case 4: // middle note
-                        {
-                            int middleNote = std::stoi(line);
-                            keyboardMapValues.setProperty(IDs::middleNote, middleNote, &undoManager);
-                            if(middleNote < 0 || middleNote > 127) fileReadCorrectly = false;
-                            break;
-                        }
-                        case 5: //midi reference note
-                            keyboardMapValues.setProperty(IDs::referenceNote, std::stoi(line), &undoManager);
-                            break;
-                        case 6: //frequency of reference midi note
-                        {
-                            float refFreq = std::stof(line);
-                            keyboardMapValues.setProperty(IDs::referenceFreq, refFreq, &undoManager);
-                            if(refFreq <= 0.0) fileReadCorrectly = false;
-                            break;
-                        }
-                        case 7: //scale number to consider formal octave.
-                        {
-                            //this value is 1-indexed in the file. We want it to be 0-indexed, so subtract 1.
-                            int octaveScaleDegree = std::stoi(line) - 1;
-                            keyboardMapValues.setProperty(IDs::formalOctaveScaleDegree, octaveScaleDegree, &undoManager);
-                            if(octaveScaleDegree < 0 || octaveScaleDegree >= static_cast<int>(keyboardMapValues.getProperty(IDs::scaleLength))) fileReadCorrectly = false;
-                            break;
-                        }
-                        default:
-                            if(line.at(0) == 'x') { //in this case, we are mapping 'x' to -1.
-                                getMapping().add(-1);
-                            }
-                            else{
-                                int mappingVal = std::stoi(line);
-                                getMapping().add(mappingVal);
-                                if(mappingVal < 0) fileReadCorrectly = false;
-                            }
-                    }
-                    if(!fileReadCorrectly) break; // we don't need to keep reading if there is already an error.
-                }
-            }
-            kbmFile.close();
-            
-            
-            if(fileReadCorrectly && (lineNum < 7)) fileReadCorrectly = false; // if lineNum < 7, not all meta values were read.
-            if(fileReadCorrectly) // we don't need to do this if there is already an error.
-            {
-                for(size_t i = getMapping().size(); i < mappingSize ; i++) {getMapping().add(-1);}//fill rest of the mappings with -1
-                if(getMapping().size() != mappingSize) fileReadCorrectly = false; //wrong mapping size
-            }
-        }
-        catch (...) {fileReadCorrectly = false;} // if formatted incorrectly, return false
-        
-        if(fileReadCorrectly)
-        {
-            return true;
-        }
-        else
-        {
-            undoManager.undo();
-            return false;
-        }
-    }
-    else return false; // if file didn't open, return false;
-}
-bool KeyboardMap::loadKbmString(std::string kbmString)
-{
-    std::string tmpfilePath = utils::makeAndWriteTmpFile(kbmString);
-    
-    bool output = loadKbmFile(tmpfilePath);
-    remove(tmpfilePath.c_str());
-    return output;
-}
-
-int KeyboardMap::getMappingIndex(juce::int8 midiNoteNum)
-{
-    assert(getMapping().size() > 0);
-    int index;
-    if(midiNoteNum >= getMiddleNote())
-    {
-        index = utils::mod(midiNoteNum - getMiddleNote(), getMapping().size());
-    }
-    else{
-        index = getMapping().size() - utils::mod((getMiddleNote() - midiNoteNum), getMapping().size());
-        if(index == getMapping().size()) index = 0;
-    }
-    return index;
-}
-/**
- Returns the scale degree for a given midi note
- */
-//TODO: fix so that it only works when midiNoteNum is in the correct midiRange
-int KeyboardMap::getScaleDegree(juce::int8 midiNoteNum)
-{
-    return getMapping(getMappingIndex(midiNoteNum));
-}
-
-int KeyboardMap::getOctave(juce::int8 midiNoteNum)
-{
-   juce::int8 diff = midiNoteNum -  getMiddleNote();
-    int output = (int) diff / (int) getMapping().size();
-    if(diff < 0 && diff % (int) getMapping().size() != 0) output--;//because division is symettric around 0, we need to decrement the octave when diff is negative.
-    return output;
-}
+/*
+ ==============================================================================
+ 
+ KeyboardMap.cpp
+ Created: 23 May 2021 5:06:31pm
+ Author:  Willow Weiner
+ 
+ ==============================================================================
+ */
+
+#include "JuceHeader.h"
+
+#include "Identifiers.h"  //stores all juce::Identifier s in namespace "IDs"
+#include "KeyboardMap.h"
+#include "TuningCache.h"
+#include "utils.h"
+
+KeyboardMap::KeyboardMap(juce::UndoManager& um) : keyboardMapValues(IDs::keyboardMap), undoManager(um)
+{
+    keyboardMapValues.addListener(this);
+    setDefaultValues();
+}
+
+KeyboardMap::KeyboardMap(juce::UndoManager& um, int sclLength) : KeyboardMap(um) { setToDefaultMapping(sclLength); }
+KeyboardMap::KeyboardMap(juce::UndoManager& um, int sclLength, std::string kbmPath) : KeyboardMap(um)
+{
+    keyboardMapValues.setProperty(IDs::scaleLength, sclLength, &undoManager);
+    loadKbmFile(kbmPath);
+}
+
+void KeyboardMap::setDefaultValues()
+{
+    keyboardMapValues.setProperty(IDs::retuneRangeLowerBound,
+                                  (signed char) 0, &undoManager);
+    keyboardMapValues.setProperty(IDs::retuneRangeUpperBound,
+                                  (signed char) 127, &undoManager);
+    keyboardMapValues.setProperty(IDs::middleNote,
+                                  (signed char) 60, &undoManager);
+    keyboardMapValues.setProperty(IDs::referenceNote,
+                                  (signed char) 69, &undoManager);
+    keyboardMapValues.setProperty(IDs::referenceFreq,
+                                  440.f, &undoManager);
+    keyboardMapValues.setProperty(IDs::formalOctaveScaleDegree,
+                                  -1, &undoManager);
+    keyboardMapValues.setProperty(IDs::scaleLength,
+                                  -1, &undoManager);
+    keyboardMapValues.setProperty(IDs::keyboardMapping,
+                                  juce::Array<juce::var>(), &undoManager);
+}
+
+void KeyboardMap::setToDefaultMapping(int scaleLength)
+{
+    setDefaultValues();
+    keyboardMapValues.setProperty(IDs::scaleLength,
+                                  scaleLength, &undoManager);
+    keyboardMapValues.setProperty(IDs::formalOctaveScaleDegree,
+                                  scaleLength - 1, &undoManager);
+    juce::Array<juce::var> mapping;
+    for(int i = 0; i < scaleLength; i++)
+    {
+        mapping.add(juce::var(i));
+    }
+    keyboardMapValues.setProperty(IDs::keyboardMapping, mapping, &undoManager); //set as a new property, so that scaleDegrees is updated
+}
+
+void KeyboardMap::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property)
+{
+    if(tree == keyboardMapValues && property == IDs::keyboardMapping) syncScaleDegrees();
+}
+
+void KeyboardMap::syncScaleDegrees()
+{
+    const juce::Array<juce::var>& mapping = getMapping();
+    scaleDegrees.resize(static_cast<size_t>(mapping.size()));
+    for(int i = 0; i < mapping.size(); i++) scaleDegrees[static_cast<size_t>(i)] = static_cast<juce::int16>(static_cast<int>(mapping.getUnchecked(i)));
+}
+
+bool KeyboardMap::loadKbmFile(std::string kbmPath)
+{
+    std::string kbmText;
+    if(!scala::readFile(kbmPath, kbmText)) return false; // if file didn't open, return false;
+    return loadKbmString(kbmText);
+}
+bool KeyboardMap::loadKbmString(std::string_view kbmString)
+{
+    return loadKbm(*TuningCache::parseKbm(kbmString, keyboardMapValues.getProperty(IDs::scaleLength)));
+}
+bool KeyboardMap::loadKbm(const scala::KbmData& kbm)
+{
+    if(!kbm.isValid) return false; // nothing has been changed yet, so there is nothing to undo.
+    int scaleLength = keyboardMapValues.getProperty(IDs::scaleLength);
+    if(scaleLength >= 0 && kbm.formalOctaveScaleDegree >= scaleLength) return false; // kbm was parsed without knowing the scale (ex: from a ScalePack)
+    
+    undoManager.beginNewTransaction();
+    juce::Array<juce::var> mapping;
+    for(int scaleDegree : kbm.mapping) mapping.add(scaleDegree);
+    keyboardMapValues.setProperty(IDs::retuneRangeLowerBound, kbm.retuneRangeLowerBound, &undoManager);
+    keyboardMapValues.setProperty(IDs::retuneRangeUpperBound, kbm.retuneRangeUpperBound, &undoManager);
+    keyboardMapValues.setProperty(IDs::middleNote, kbm.middleNote, &undoManager);
+    keyboardMapValues.setProperty(IDs::referenceNote, kbm.referenceNote, &undoManager);
+    keyboardMapValues.setProperty(IDs::referenceFreq, kbm.referenceFreq, &undoManager);
+    keyboardMapValues.setProperty(IDs::formalOctaveScaleDegree, kbm.formalOctaveScaleDegree, &undoManager);
+    keyboardMapValues.setProperty(IDs::keyboardMapping, mapping, &undoManager);
+    return true;
+}
+
+int KeyboardMap::getMappingIndex(juce::int8 midiNoteNum)
+{
+    assert(getMappingSize() > 0);
+    int index;
+    if(midiNoteNum >= getMiddleNote())
+    {
+        index = utils::mod(midiNoteNum - getMiddleNote(), getMappingSize());
+    }
+    else{
+        index = getMappingSize() - utils::mod((getMiddleNote() - midiNoteNum), getMappingSize());
+        if(index == getMappingSize()) index = 0;
+    }
+    return index;
+}
+/**
+ Returns the scale degree for a given midi note
+ */
+//TODO: fix so that it only works when midiNoteNum is in the correct midiRange
+int KeyboardMap::getScaleDegree(juce::int8 midiNoteNum)
+{
+    return getMapping(getMappingIndex(midiNoteNum));
+}
+
+int KeyboardMap::getOctave(juce::int8 midiNoteNum)
+{
+   juce::int8 diff = midiNoteNum -  getMiddleNote();
+    int output = (int) diff / (int) getMappingSize();
+    if(diff < 0 && diff % (int) getMappingSize() != 0) output--;//because division is symettric around 0, we need to decrement the octave when diff is negative.
+    return output;
+}
@@ -1,118 +1,151 @@
-/*
- ==============================================================================
- 
- KeyboardMap.h
- 
- This class acts as a wrapper for the Scala '.kbm' file type.
- It allows users to configure which input midi note numbers are matched to which Scale Degree.
- See more here: http://www.huygens-fokker.org/scala/help.htm#mappings 
- 
- 
- Created: 21 May 2021 10:20:59pm
- Author:  Willow Weiner
- 
- ==============================================================================
- */
-
-#pragma once
-
-#include <string>
-#include <vector>
-
-#include "JuceHeader.h"
-
-#include "Identifiers.h"
-
-class KeyboardMap
-{
-public:
-    KeyboardMap(juce::UndoManager& um);
-    KeyboardMap(juce::UndoManager& um, int scaleLength);
-    KeyboardMap(juce::UndoManager& um, int scaleLength, std::string kbmPath);
-
-    juce::ValueTree keyboardMapValues;
-        
-    /**
-     Sets the mapping to a default state, based on the length of the scale.
-     The default state is a linear, one-note-per-key mapping. For example, if we define the center midi note =: 'c',
-     we get the default mapping:
-     
-     MIDI NOTE NUM         -> SCALE DEGREE
-     ...
-     c- scaleLength             -> 0
-     c-scaleLength + 1        -> 1
-     ...
-     c-2                               -> scaleLength - 2
-     c-1                               -> scaleLength - 1
-     c                                  -> 0
-     c+1                              -> 1
-     c+2                              -> 2
-     ...
-     c+ scaleLength - 1      -> scaleLength - 1
-     c+ scaleLength           -> 0
-     ...
-     
-     @param scaleLength. The number of notes in the scale this map is serviceing.
-     */
-    void setToDefaultMapping(int scaleLength);
-    // ==============================================================================
-    // Getters and Setters
-    // ==============================================================================
-    
-    //TODO: move these definitions to .cpp file.
-    juce::Array<juce::var>& getMapping(){
-        jassert(keyboardMapValues.hasProperty(IDs::keyboardMapping));
-        jassert(keyboardMapValues.getProperty(IDs::keyboardMapping).isArray());
-        return *(keyboardMapValues.getProperty(IDs::keyboardMapping).getArray());
-    }
-    int getMapping(int midiNote){
-        if(midiNote >= getMapping().size() || midiNote < 0) return -1;
-        return getMapping().getUnchecked(midiNote);
-    }
-    
-    int getRetuneRangeUpperBound(){return keyboardMapValues.getProperty(IDs::retuneRangeUpperBound);}
-    int getRetuneRangeLowerBound(){return keyboardMapValues.getProperty(IDs::retuneRangeLowerBound);}
-    int getMiddleNote(){return keyboardMapValues.getProperty(IDs::middleNote);}
-    int getReferenceMidiNote(){return keyboardMapValues.getProperty(IDs::referenceNote);}
-    float getReferenceFreq(){return keyboardMapValues.getProperty(IDs::referenceFreq);}
-    int getFormalOctaveScaleDegree(){return keyboardMapValues.getProperty(IDs::formalOctaveScaleDegree);}
-    
-    // ==============================================================================
-    // File Parsing
-    // ==============================================================================
-    bool loadKbmFile(std::string kbmPath);
-    bool loadKbmString(std::string kbmString);
-    
-    
-    // ==============================================================================
-    // Main functionality
-    // ==============================================================================
-    /**
-     @param midiNoteNum. The juce::int8 midi note number.
-     @return The int index associated to midiNoteNum in the keyboardMapping.
-     */
-    int getMappingIndex(juce::int8 midiNoteNum);
-    /**
-     * Returns the scale degree for a given midi note
-     * @param midiNoteNum the midi note number. on [0,127]
-     * @return the associated scale degree (of scale stored in this->notes)
-     */
-    int getScaleDegree(juce::int8 midiNoteNum);
-    /**
-     Returns how how many octaves above (positive) or below (negative) a note is compared to the middleNote.
-     @param
-     */
-    int getOctave(juce::int8 midiNoteNum);
-    
-    /**
-     Modulates from center to pivot. The frequency-ratios around pivot after modulation will be the same as those around center before modulation.
-     @param center midino
-     @param pivot
-     */
-    void modulate(juce::int8 center, juce::int8 pivot);
-    
-private:
-    juce::UndoManager& undoManager;
-    
-    void setDefaultValues();
-};
+/*
+ ==============================================================================
+ 
+ KeyboardMap.h
+ 
+ This class acts as a wrapper for the Scala '.kbm' file type.
+ It allows users to configure which input midi note numbers are matched to which Scale Degree.
+ See more here: http://www.huygens-fokker.org/scala/help.htm#mappings 
+ 
+ 
+ Created: 21 May 2021 10:20:59pm
+ Author:  Willow Weiner
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "Identifiers.h"
+#include "ScalaParser.h"
+
+class KeyboardMap : public juce::ValueTree::Listener
+{
+public:
+    KeyboardMap(juce::UndoManager& um);
+    KeyboardMap(juce::UndoManager& um, int scaleLength);
+    KeyboardMap(juce::UndoManager& um, int scaleLength, std::string kbmPath);
+
+    juce::ValueTree keyboardMapValues;
+        
+    /**
+     Sets the mapping to a default state, based on the length of the scale.
+     The default state is a linear, one-note-per-key mapping. For example, if we define the center midi note =: 'c',
+     we get the default mapping:
+     
+     MIDI NOTE NUM         -> SCALE DEGREE
+     ...
+     c- scaleLength             -> 0
+     c-scaleLength + 1        -> 1
+     ...
+     c-2                               -> scaleLength - 2
+     c-1                               -> scaleLength - 1
+     c                                  -> 0
+     c+1                              -> 1
+     c+2                              -> 2
+     ...
+     c+ scaleLength - 1      -> scaleLength - 1
+     c+ scaleLength           -> 0
+     ...
+     
+     @param scaleLength. The number of notes in the scale this map is serviceing.
+     */
+    void setToDefaultMapping(int scaleLength);
+    // ==============================================================================
+    // Getters and Setters
+    // ==============================================================================
+    
+    //TODO: move these definitions to .cpp file.
+    /**
+     @return The mapping as it is stored in keyboardMapValues, for saving and undo.
+     Editing this array in place doesn't update getScaleDegrees().
+     */
+    juce::Array<juce::var>& getMapping(){
+        jassert(keyboardMapValues.hasProperty(IDs::keyboardMapping));
+        jassert(keyboardMapValues.getProperty(IDs::keyboardMapping).isArray());
+        return *(keyboardMapValues.getProperty(IDs::keyboardMapping).getArray());
+    }
+    /**
+     @return The scale degree of each key in the mapping pattern, or -1 for unmapped keys.
+     Kept in sync with the keyboardMapping property, so reading it never touches the ValueTree.
+     */
+    const std::vector<juce::int16>& getScaleDegrees() const { return scaleDegrees; }
+    int getMappingSize() const { return static_cast<int>(scaleDegrees.size()); }
+    int getMapping(int midiNote){
+        if(midiNote >= getMappingSize() || midiNote < 0) return -1;
+        return scaleDegrees[static_cast<size_t>(midiNote)];
+    }
+    
+    int getRetuneRangeUpperBound(){return keyboardMapValues.getProperty(IDs::retuneRangeUpperBound);}
+    int getRetuneRangeLowerBound(){return keyboardMapValues.getProperty(IDs::retuneRangeLowerBound);}
+    int getMiddleNote(){return keyboardMapValues.getProperty(IDs::middleNote);}
+    int getReferenceMidiNote(){return keyboardMapValues.getProperty(IDs::referenceNote);}
+    float getReferenceFreq(){return keyboardMapValues.getProperty(IDs::referenceFreq);}
+    int getFormalOctaveScaleDegree(){return keyboardMapValues.getProperty(IDs::formalOctaveScaleDegree);}
+    
+    // ==============================================================================
+    // File Parsing
+    // ==============================================================================
+    bool loadKbmFile(std::string kbmPath);
+    /**
+     Loads a keyboard map based on a .kbm file stored in a string. Nothing is written to disk.
+     */
+    bool loadKbmString(std::string_view kbmString);
+    /**
+     Loads a keyboard map that has already been parsed. If kbm isn't valid, nothing changes.
+     @return kbm.isValid
+     */
+    bool loadKbm(const scala::KbmData& kbm);
+    
+    
+    // ==============================================================================
+    // Main functionality
+    // ==============================================================================
+    /**
+     @param midiNoteNum. The juce::int8 midi note number.
+     @return The int index associated to midiNoteNum in the keyboardMapping.
+     */
+    int getMappingIndex(juce::int8 midiNoteNum);
+    /**
+     * Returns the scale degree for a given midi note
+     * @param midiNoteNum the midi note number. on [0,127]
+     * @return the associated scale degree (of scale stored in this->notes)
+     */
+    int getScaleDegree(juce::int8 midiNoteNum);
+    /**
+     Returns how how many octaves above (positive) or below (negative) a note is compared to the middleNote.
+     @param
+     */
+    int getOctave(juce::int8 midiNoteNum);
+    
+    /**
+     Modulates from center to pivot. The frequency-ratios around pivot after modulation will be the same as those around center before modulation.
+     @param center midino
+     @param pivot
+     */
+    void modulate(juce::int8 center, juce::int8 pivot);
+
+    /**
+     Copies the keyboardMapping property into scaleDegrees when it changes (including after an undo).
+     */
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property) override;
+    /**
+     Copies the keyboardMapping property into scaleDegrees. Listeners on a parent tree can call this before reading
+     getScaleDegrees(), since they may be called before this object's listener.
+     */
+    void syncScaleDegrees();
+    
+private:
+    juce::UndoManager& undoManager;
+    std::vector<juce::int16> scaleDegrees; // a typed copy of the keyboardMapping property
+    
+    void setDefaultValues();
+
+    JUCE_DECLARE_NON_COPYABLE(KeyboardMap) // a copy wouldn't be listening to keyboardMapValues, so its scaleDegrees would go stale
+};
@@ -1,197 +1,1126 @@
-#pragma once
-
-
-#include <string>
-
-#include "JuceHeader.h"
-
-#include "Identifiers.h"
-#include "Scale.h"
-#include "KeyboardMap.h"
-#include "utils.h"
-
-class MidiProcessor
-{
-private:
-    bool hasSentSetupMessages;
-    juce::MidiBuffer setupMessages;
-    
-    juce::MPEZoneLayout zoneLayout; //for channelAssigner
-    juce::MPEChannelAssigner channelAssigner;
-    
-    juce::Array<juce::int8> midiNoteChannelMap; // midiNoteChannelMap[noteNum] stores which channel noteNum is being played on, or -1 if noteNum is not currently mapped/being played
-    
-
-    void sendSetupMessages() {
-        processedBuffer.addEvents(setupMessages, 0, -1, 0);
-        hasSentSetupMessages = true;
-    }
-    
-    void makeSetupMessages() {
-        zoneLayout.setLowerZone(15, 1, 2);
-        zoneLayout.setUpperZone(0, 1, 2);
-        setupMessages.addEvents(juce::MPEMessages::setZoneLayout(zoneLayout),
-                                0, -1, 0);
-    }
-    void initMidiNoteChannelMap() {
-        midiNoteChannelMap.resize(128); //128, because there are 128 midi values
-        midiNoteChannelMap.fill(static_cast<juce::int8>(-1)); //nothing is currently being played
-    }
-    
-    
-    void setChannelAndNoteNumber(juce::MidiMessage& message, int samplePosition, bool shouldSendPitchBendMessage) {
-        juce::int8 channel = midiNoteChannelMap.getUnchecked(message.getNoteNumber());
-        if(channel == -1)
-        {
-            channel = channelAssigner.findMidiChannelForNewNote(message.getNoteNumber());
-            midiNoteChannelMap.set(message.getNoteNumber(), channel);
-        }
-       message.setChannel(channel);
-       
-       double unRoundedMidiNoteNum = utils::freqToMidi(scale.getFreq(message.getNoteNumber()), 440.0f);
-       double midiNoteNum = std::round(unRoundedMidiNoteNum);
-       message.setNoteNumber(midiNoteNum);
-        
-        if(shouldSendPitchBendMessage)
-        {
-            typedef juce::MidiMessage Msg;
-            auto pitchBendVal = Msg::pitchbendToPitchwheelPos(midiNoteNum - unRoundedMidiNoteNum,
-                                                                                             zoneLayout.getLowerZone().perNotePitchbendRange);
-            processedBuffer.addEvent(Msg::pitchWheel(channel, pitchBendVal), samplePosition);
-        }
-    }
-    
-    
-    void processNoteOn(juce::MidiMessage& message, int samplePosition)
-    {
-        midiProcessorValues.setProperty(IDs::lastNotePlayed, message.getNoteNumber(), &undoManager);
-        setChannelAndNoteNumber(message, samplePosition, true);
-    }
-    void processNoteOff(juce::MidiMessage& message, int samplePosition)
-    {
-        auto noteNum = message.getNoteNumber();
-        juce::int8 channel = midiNoteChannelMap.getUnchecked(noteNum);
-        if(channel != -1) setChannelAndNoteNumber(message, samplePosition, false);
-            
-        channelAssigner.noteOff(noteNum);
-        midiNoteChannelMap.set(noteNum, -1);
-
-    }
-    void processAllNotesOff(juce::MidiMessage& message, int samplePosition)
-    {
-        channelAssigner.allNotesOff();
-        initMidiNoteChannelMap();
-    }
-    void processAftertouch(juce::MidiMessage& message, int samplePosition)
-    {
-        setChannelAndNoteNumber(message, samplePosition, false);
-    }
-    
-    bool shouldAddMessage(const juce::MidiMessage message)
-    {
-        return !message.isPitchWheel();
-    }
-    
-public:
-    MidiProcessor(juce::UndoManager& um) : hasSentSetupMessages(false), undoManager(um), scale(um), midiProcessorValues(IDs::midiProcessor)
-    {
-        makeSetupMessages();
-        initMidiNoteChannelMap();
-        channelAssigner =  juce::MPEChannelAssigner(zoneLayout.getLowerZone());
-        
-        midiProcessorValues.addChild(scale.scaleValues, -1, &undoManager);
-        
-        midiProcessorValues.setProperty(IDs::lastNotePlayed, -1, &undoManager);
-        midiProcessorValues.setProperty(IDs::modCenter, 60, &undoManager);
-        midiProcessorValues.setProperty(IDs::modPivot, 60, &undoManager);
-
-    }
-    /**
-     Function for processing Midi messages. Using a .scl file, it retunes the message using MPE and pitchbend.
-     @param midiMessages The MIDI buffer sent from  PluginProcessor::processBlock. Contains all MIDI for processing.
-     */
-    void process(juce::MidiBuffer& midiMessages)
-    {
-//        processedBuffer.clear();
-//        if(!hasSentSetupMessages) sendSetupMessages();
-        
-        if(scale.hasSclLoaded()) //if no scl has been loaded, skip all processing
-        {
-            juce::MidiMessage message;
-            for(const juce::MidiMessageMetadata metadata : midiMessages)
-            {
-                message = metadata.getMessage();
-                
-                if(message.isNoteOn()) processNoteOn(message, metadata.samplePosition);
-                if(message.isNoteOff()) processNoteOff(message, metadata.samplePosition);
-                if(message.isAllNotesOff()) processAllNotesOff(message, metadata.samplePosition);
-                if(message.isAftertouch()) processAftertouch(message, metadata.samplePosition);
-
-                if(shouldAddMessage(message)) processedBuffer.addEvent(message, metadata.samplePosition);
-            }
-        }
-        
-        midiMessages.clear();
-        midiMessages.swapWith(processedBuffer);
-    }
-    
-    /**
-    Sets the center for modulation.
-    @param newCenter. The juce::int8 representation of a Midi Note to set  modulation center to.
-    */
-    void setCenter(juce::var newCenter){ midiProcessorValues.setProperty(IDs::modCenter, newCenter, &undoManager);}
-   /**
-    Sets the center for modulation to the last midiNote that was played.
-    */
-    void setCenter()
-    {
-        setCenter(midiProcessorValues.getProperty(IDs::lastNotePlayed));
-        
-    }
-    /**
-     Sets the pivot for modulation.
-     @param newPivot. The juce::int8 representation of a Midi Note to set  modulation pivot to.
-     */
-    void setPivot(juce::var newPivot){ midiProcessorValues.setProperty(IDs::modPivot, newPivot, &undoManager);}
-    /**
-     Sets the pivot for modulation to the last midiNote that was played.
-     */
-    void setPivot()
-    {
-        setPivot(midiProcessorValues.getProperty(IDs::lastNotePlayed));
-    }
-    
-    /**
-     Calls scale.modulate() if appropriate
-     */
-    void modulate()
-    {
-        juce::var pivotVar = midiProcessorValues.getProperty(IDs::modPivot);
-        juce::var centerVar = midiProcessorValues.getProperty(IDs::modCenter);
-        
-        if(pivotVar.isInt() && centerVar.isInt()){
-            int pivot = pivotVar;
-            int center = centerVar;
-            if((pivot >= 0)
-               && (pivot < 128)
-               && (center >= 0)
-               && (center < 128)
-               )
-            {
-                scale.modulate(center, pivot);
-            }
-        }
-    }
-    
-    void undo()
-    {
-        undoManager.undo();
-    }
-    
-    
-    juce::MidiBuffer processedBuffer;
-    juce::UndoManager& undoManager;
-    Scale scale;
-    
-    juce::ValueTree midiProcessorValues;
-};
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+#include "JuceHeader.h"
+
+#include "AllocationChecker.h"
+#include "ChannelAllocator.h"
+#include "ChannelGlides.h"
+#include "Identifiers.h"
+#include "Scale.h"
+#include "KeyboardMap.h"
+#include "MidiTuningStandard.h"
+#include "ModulationHistory.h"
+#include "ModulationTriggers.h"
+#include "OutputModeState.h"
+#include "PluginState.h"
+#include "RetuneTable.h"
+#include "UniversalMidiPackets.h"
+#include "TuningSnapshot.h"
+#include "utils.h"
+
+class MidiProcessor
+{
+public:
+    /**
+     The host automatable parameters that MidiProcessor reads on the audio thread, as returned by
+     juce::AudioProcessorValueTreeState::getRawParameterValue(). Any of them can be nullptr, and are then left at their defaults.
+     */
+    struct HostParameters
+    {
+        std::atomic<float>* center = nullptr;        // the center of modulations triggered by modulate
+        std::atomic<float>* pivot = nullptr;         // the pivot of modulations triggered by modulate
+        std::atomic<float>* modulate = nullptr;      // modulates from center to pivot each time it turns on
+        std::atomic<float>* referenceFreq = nullptr; // in Hz. Transposes the tuning by its interval from 440Hz
+        std::atomic<float>* morph = nullptr;         // between 0 (the unmodulated tuning) and 1 (fully modulated)
+    };
+    
+private:
+    juce::UndoManager& undoManager; // records tuning loads, see undoLoad(). Modulations, center, and pivot are in modulationHistory
+    Scale scale;
+    ModulationHistory modulationHistory; // every modulation since the tuning was loaded. Only used on the message thread
+    
+    bool hasSentSetupMessages = false;
+    juce::MidiBuffer setupMessages;
+    
+    juce::MPEZoneLayout zoneLayout; //for channelAllocator
+    ChannelAllocator channelAllocator;
+    
+    juce::Array<juce::int8> midiNoteChannelMap; // midiNoteChannelMap[noteNum] stores which channel noteNum is being played on, or -1 if noteNum is not currently mapped/being played
+    juce::Array<juce::int8> midiNoteOutputMap; // midiNoteOutputMap[noteNum] stores which note number noteNum was retuned to, so that the note off matches even if the tuning changes while it is held
+    
+    // Tuning handoff between the message thread and the audio thread (RCU-style).
+    // publishTuning() compiles a new TuningSnapshot and stores it in pendingSnapshot. At the start of process(),
+    // the audio thread swaps it into activeSnapshot and pushes the snapshot it replaced onto retiredSnapshots.
+    // Retired snapshots are released by releaseRetiredSnapshots() on the message thread,
+    // so the audio thread never changes a reference count, and never deletes anything.
+    std::atomic<TuningSnapshot*> pendingSnapshot { nullptr };
+    TuningSnapshot* activeSnapshot = nullptr; // only used by the audio thread
+    static constexpr int maxRetiredSnapshots = 32;
+    juce::AbstractFifo retiredSnapshotsFifo { maxRetiredSnapshots };
+    TuningSnapshot* retiredSnapshots[maxRetiredSnapshots];
+    
+    // Modulations don't publish a snapshot. publishModulation() packs a serial number and the new fixed point offset into
+    // requestedModulation. Every publish gets a new serial, and a snapshot's generation is the serial it was published with,
+    // so the audio thread applies each request once, and never applies a request from before the active snapshot.
+    int publishSerial = 0; // the serial of the last publish. only used by the message thread
+    int snapshotGeneration = 0; // the generation of the last published snapshot. only used by the message thread
+    std::atomic<juce::int64> requestedModulation { 0 };
+    juce::int64 modulationOffset = 0; // the fixed point offset from the unmodulated tuning of the active snapshot. only used by the audio thread
+    int lastModulationSerial = 0; // the serial of the last request that was applied. only used by the audio thread
+    static constexpr int modulationOffsetBits = 48;
+    static juce::int64 packModulation(int serial, juce::int64 offset)
+    {
+        return static_cast<juce::int64>((static_cast<juce::uint64>(serial & 0xffff) << modulationOffsetBits)
+                                        | (static_cast<juce::uint64>(offset) & ((1ull << modulationOffsetBits) - 1)));
+    }
+    static int unpackSerial(juce::int64 packed) { return static_cast<int>(static_cast<juce::uint64>(packed) >> modulationOffsetBits); }
+    static juce::int64 unpackOffset(juce::int64 packed)
+    {
+        auto offset = static_cast<juce::uint64>(packed) & ((1ull << modulationOffsetBits) - 1);
+        if(offset & (1ull << (modulationOffsetBits - 1))) offset |= ~((1ull << modulationOffsetBits) - 1); //sign extend
+        return static_cast<juce::int64>(offset);
+    }
+    
+    // Modulations triggered from inside the midi stream (see setModulationKeyRange(), setModulationController(), and setProgramChangeResetsModulation()).
+    // The audio thread applies them at the trigger's sample position, so they are sample accurate and the same on every render,
+    // and reports each one back packed like requestedModulation, with the generation of the snapshot it was applied to,
+    // so publishStreamModulations() can give every one of them its own step in the modulation history.
+    ModulationTriggers modulationTriggers;
+    static constexpr int maxModulationsPerBlock = 4; // the retunes per block (after modulations) that processedBuffer has room for. See updateRetuneOffset()
+    int numRetunesInBlock = 0; // only used by the audio thread
+    int deferredRetuneSample = -1; // where the retune that later modulations were merged into goes, or -1. only used by the audio thread
+    
+    // Host parameters are read once at the start of each block, so automation gives the same result in realtime and offline.
+    // Morph and the reference frequency are global offsets like modulation, so changing them never needs a new snapshot.
+    HostParameters hostParameters; // set before processing starts
+    bool isModulateParameterOn = false; // only used by the audio thread, so modulate only triggers when it turns on
+    std::atomic<bool> shouldSyncModulateParameter { true }; // set when modulate may already be on without having been turned on (ex: a restored state)
+    float morph = 1.0f, referenceFreq = 440.0f; // the parameter values that retuneOffset was last worked out with. only used by the audio thread
+    juce::int64 referenceOffset = 0; // the fixed point interval from 440Hz to referenceFreq. only used by the audio thread
+    juce::int64 retuneOffset = 0; // what getRetune() adds to each entry: modulationOffset scaled by morph, plus referenceOffset. only used by the audio thread
+    
+    std::atomic<int> lastNotePlayed { -1 }; // written by the audio thread. copied to midiProcessorValues by publishLastNotePlayed()
+    std::atomic<bool> poolChannelsByBend { true }; // applied to channelAllocator at the start of each block
+    bool useStaticChannelLayout = false; // only used on the message thread, when compiling snapshots
+    OutputModeState output;
+    std::bitset<128> allocatedNotes; // input notes that are being played on a channel from channelAllocator (as opposed to passed through in MTS mode)
+    
+    // Buffer sizing. processedBuffer and spareBuffers are preallocated in prepareToPlay() so that process() never allocates.
+    juce::MidiBuffer processedBuffer;
+    ump::PacketBuffer umpOutput; // the output of the last call to process() in OutputMode::ump. SysEx is still passed through in midiMessages
+    static constexpr int maxBytesPerEvent = sizeof(juce::int32) + sizeof(juce::uint16) + 3; // MidiBuffer stores a timestamp, size, and up to 3 bytes per short message
+    static constexpr int maxOutputEventsPerInputEvent = 2; // a note on can be preceded by a pitch wheel message (or followed by a per-note pitch bend)
+    static constexpr int minEventsPerBlock = 256;
+    double maxEventDensity = 1.0; // the most input events per sample that process() can handle without allocating
+    static constexpr int numSpareBuffers = 2; // how many undersized buffers of its own the host can hand over (ex: double buffering) before the output is copied. See swapOutput()
+    juce::MidiBuffer spareBuffers[numSpareBuffers];
+    int numSpareBuffersLeft = 0; // the spares that still have their preallocated storage
+    const juce::uint8* ownStorage[1 + numSpareBuffers] = {}; // the preallocated storage of processedBuffer and spareBuffers, wherever it has been swapped to since
+    double sampleRate = 44100.0;
+    int samplesPerBlock = 512;
+    
+    // Retuning held notes after a modulation. Each member channel with held notes glides from its old pitch wheel position to the new one.
+    ChannelGlides glides;
+    
+    // The last pitch wheel position sent on each output channel (or ChannelAllocator::unknownPitchWheel), so that identical bends are never sent twice.
+    int lastPitchWheelSent[17]; // only used by the audio thread
+    std::atomic<juce::int64> numPitchWheelsSaved { 0 };
+    
+    const RetuneTable& getRetuneTable() const { return activeSnapshot->getRetuneTable(); }
+    /**
+     @return How noteNum should be played with the active snapshot and the current modulation offset.
+     */
+    RetuneTable::Entry getRetune(int noteNum) const
+    {
+        return RetuneTable::transpose(getRetuneTable()[noteNum], retuneOffset,
+                                      static_cast<float>(zoneLayout.getLowerZone().perNotePitchbendRange));
+    }
+    
+    /**
+     Swaps a newly published snapshot in as activeSnapshot. Called on the audio thread at the start of process().
+     If there is no room to retire the current snapshot, the swap is tried again next block.
+     */
+    void updateActiveSnapshot()
+    {
+        if(pendingSnapshot.load() == nullptr || retiredSnapshotsFifo.getFreeSpace() == 0) return;
+        
+        TuningSnapshot* newSnapshot = pendingSnapshot.exchange(nullptr);
+        if(activeSnapshot != nullptr)
+        {
+            int start1, size1, start2, size2;
+            retiredSnapshotsFifo.prepareToWrite(1, start1, size1, start2, size2);
+            retiredSnapshots[size1 > 0 ? start1 : start2] = activeSnapshot;
+            retiredSnapshotsFifo.finishedWrite(size1 + size2);
+        }
+        activeSnapshot = newSnapshot;
+        modulationOffset = activeSnapshot->getModulationOffset();
+        retuneOffset = calcRetuneOffset();
+        lastModulationSerial = activeSnapshot->getGeneration() & 0xffff;
+        
+        if(output.isUsingMts()) sendMtsTuning(false, 0);
+        if(!output.isUsingMts() && !output.isUsingUmp() && activeSnapshot->hasStaticChannelLayout()) sendStaticChannelLayout(0);
+    }
+    /**
+     Applies the offset from the last call to publishModulation(), if it hasn't been applied yet and was published after the active snapshot.
+     Called on the audio thread at the start of process().
+     */
+    void updateModulationOffset()
+    {
+        if(activeSnapshot == nullptr || pendingSnapshot.load() != nullptr) return; // the request may be for the snapshot that is waiting to be swapped in
+        juce::int64 requested = requestedModulation.load();
+        int serial = unpackSerial(requested);
+        if(serial == lastModulationSerial || static_cast<juce::int16>(serial - (activeSnapshot->getGeneration() & 0xffff)) < 0) return;
+        lastModulationSerial = serial;
+        setModulationOffset(unpackOffset(requested), 0);
+    }
+    /**
+     Reads the host parameters. Called on the audio thread at the start of process(), so parameter changes take effect at the start of a block.
+     */
+    void processHostParameters()
+    {
+        if(hostParameters.modulate != nullptr)
+        {
+            bool isOn = hostParameters.modulate->load(std::memory_order_relaxed) >= 0.5f;
+            if(shouldSyncModulateParameter.exchange(false)) isModulateParameterOn = isOn; // the modulation it made is already in the restored history
+            if(isOn && !isModulateParameterOn && activeSnapshot != nullptr && activeSnapshot->hasSclLoaded())
+            {
+                modulateInStream(getModulationCenter(), getModulationPivot(), 0);
+            }
+            isModulateParameterOn = isOn;
+        }
+        float newMorph = hostParameters.morph != nullptr ? juce::jlimit(0.0f, 1.0f, hostParameters.morph->load(std::memory_order_relaxed)) : 1.0f;
+        float newReferenceFreq = hostParameters.referenceFreq != nullptr ? hostParameters.referenceFreq->load(std::memory_order_relaxed) : 440.0f;
+        if(newMorph == morph && newReferenceFreq == referenceFreq) return;
+        
+        morph = newMorph;
+        if(newReferenceFreq != referenceFreq)
+        {
+            referenceFreq = newReferenceFreq;
+            referenceOffset = referenceFreq > 0.0f ? RetuneTable::toFixedOffset(12.0 * std::log2(referenceFreq / 440.0)) : 0;
+        }
+        updateRetuneOffset(0);
+    }
+    int getModulationCenter() const
+    {
+        if(hostParameters.center != nullptr) return juce::roundToInt(hostParameters.center->load(std::memory_order_relaxed));
+        return modulationTriggers.getCenter();
+    }
+    int getModulationPivot() const
+    {
+        if(hostParameters.pivot != nullptr) return juce::roundToInt(hostParameters.pivot->load(std::memory_order_relaxed));
+        return modulationTriggers.getPivot();
+    }
+    /**
+     Applies message if it triggers a modulation. Called on the audio thread, in the order of the midi stream,
+     so notes before the trigger keep the old tuning, and notes after it get the new one.
+     @return true if message is a trigger (or a reserved key), and shouldn't be played.
+     */
+    bool processModulationTrigger(const juce::MidiMessage& message, int samplePosition)
+    {
+        bool isNotePlaying = message.isNoteOnOrOff() && midiNoteChannelMap.getUnchecked(message.getNoteNumber()) != -1;
+        ModulationTriggers::Trigger trigger = modulationTriggers.process(message, isNotePlaying);
+        switch(trigger.type)
+        {
+            case ModulationTriggers::TriggerType::none: return false;
+            case ModulationTriggers::TriggerType::ignored: break;
+            case ModulationTriggers::TriggerType::keys: modulateInStream(trigger.center, trigger.pivot, samplePosition); break;
+            case ModulationTriggers::TriggerType::controller: modulateInStream(getModulationCenter(), getModulationPivot(), samplePosition); break;
+            case ModulationTriggers::TriggerType::reset: applyStreamModulation(0, samplePosition); break;
+        }
+        return true;
+    }
+    /**
+     Modulates from center to pivot (like Scale::modulate()) on the audio thread.
+     */
+    void modulateInStream(int center, int pivot, int samplePosition)
+    {
+        double interval = activeSnapshot->getModulationInterval(center, pivot);
+        if(center == pivot || std::isnan(interval)) return;
+        applyStreamModulation(modulationOffset + RetuneTable::toFixedOffset(interval), samplePosition);
+    }
+    void applyStreamModulation(juce::int64 newOffset, int samplePosition)
+    {
+        setModulationOffset(newOffset, samplePosition);
+        modulationTriggers.reportModulation(packModulation(activeSnapshot->getGeneration(), modulationOffset));
+    }
+    /**
+     Moves every note by a new modulation offset. This is constant time, apart from retuning the notes that are already sounding:
+     MTS output sends the notes that changed, a static channel layout rebends its channels, and held notes glide if setRetuneHeldNotes() is on.
+     @param newOffset The fixed point offset from the unmodulated tuning of the active snapshot.
+     @param samplePosition Where in the current block the modulation happens.
+     */
+    void setModulationOffset(juce::int64 newOffset, int samplePosition)
+    {
+        if(newOffset == modulationOffset) return;
+        modulationOffset = newOffset;
+        updateRetuneOffset(samplePosition);
+    }
+    juce::int64 calcRetuneOffset() const
+    {
+        return static_cast<juce::int64>(std::llround(morph * static_cast<double>(modulationOffset))) + referenceOffset;
+    }
+    /**
+     Works out retuneOffset again after the modulation offset or a host parameter changed, and retunes the notes that are already sounding.
+     */
+    void updateRetuneOffset(int samplePosition)
+    {
+        juce::int64 newRetuneOffset = calcRetuneOffset();
+        if(newRetuneOffset == retuneOffset) return;
+        retuneOffset = newRetuneOffset;
+        if(activeSnapshot == nullptr || !activeSnapshot->hasSclLoaded()) return;
+        
+        // processedBuffer only has room to retune maxModulationsPerBlock times per block. The last retune is kept for the end of the block,
+        // and every modulation that reaches it is merged into it, however many triggers the block has.
+        if(numRetunesInBlock >= maxModulationsPerBlock - 1)
+        {
+            deferredRetuneSample = samplePosition;
+            return;
+        }
+        numRetunesInBlock++;
+        retuneSoundingNotes(samplePosition);
+    }
+    /**
+     Retunes the notes that are already sounding to retuneOffset: MTS output sends the notes that changed,
+     a static channel layout rebends its channels, and held notes glide if setRetuneHeldNotes() is on.
+     */
+    void retuneSoundingNotes(int samplePosition)
+    {
+        if(output.isUsingMts()) sendMtsTuning(true, samplePosition); // MTS retunes held notes by itself
+        else if(!output.isUsingUmp() && activeSnapshot->hasStaticChannelLayout()) sendStaticChannelLayout(samplePosition);
+        else if(!output.isUsingUmp() && glides.isRetuningHeldNotes()) retuneHeldNotes(samplePosition);
+    }
+    /**
+     Sends the retune that modulations past the limit were merged into, at the sample position of the last of them.
+     Until then, notes sound with the last retune that was sent.
+     */
+    void sendDeferredRetune()
+    {
+        if(deferredRetuneSample < 0) return;
+        retuneSoundingNotes(deferredRetuneSample);
+        deferredRetuneSample = -1;
+    }
+    /**
+     Starts gliding every channel with held notes to the pitchbend its notes need with the current modulation offset.
+     Held notes keep their output note number, so bends further than the pitchbend range are clamped.
+     Channels are pooled by bend, and modulation moves every note by the same interval, so each channel's lowest held note stands for all of them.
+     */
+    void retuneHeldNotes(int samplePosition)
+    {
+        const float pitchbendRange = static_cast<float>(zoneLayout.getLowerZone().perNotePitchbendRange);
+        bool isChannelRetuned[17] = {};
+        for(int noteNum = 0; noteNum < RetuneTable::numMidiNotes; noteNum++)
+        {
+            if(!allocatedNotes[noteNum]) continue;
+            RetuneTable::Entry retune = getRetune(noteNum);
+            if(!retune.isMapped) continue;
+            int channel = midiNoteChannelMap.getUnchecked(noteNum);
+            if(isChannelRetuned[channel]) continue;
+            isChannelRetuned[channel] = true;
+            startGlide(channel, RetuneTable::toPitchWheel(retune.pitch, midiNoteOutputMap.getUnchecked(noteNum), pitchbendRange), samplePosition);
+        }
+    }
+    void startGlide(int channel, int targetPitchWheel, int samplePosition)
+    {
+        int currentPitchWheel = lastPitchWheelSent[channel];
+        glides.start(channel, currentPitchWheel == ChannelAllocator::unknownPitchWheel ? targetPitchWheel : currentPitchWheel,
+                     targetPitchWheel, samplePosition);
+        channelAllocator.setPitchWheel(channel, ChannelAllocator::unknownPitchWheel); // new notes can't join the channel while it is gliding
+    }
+    /**
+     Sends the pitch wheel messages of every active glide that fall inside this block.
+     */
+    void processGlides(int numSamples)
+    {
+        glides.process(numSamples, [this](int channel, int pitchWheel, int samplePosition, bool isFinished)
+        {
+            sendPitchWheel(channel, pitchWheel, samplePosition);
+            if(isFinished) channelAllocator.setPitchWheel(channel, pitchWheel);
+        });
+    }
+    
+    /**
+     Forgets what every channel is bent to, after something may have reset the synth's pitch wheels
+     (ex: reset all controllers, or a new output mode). The next note on each channel then sends its bend, even if it was sent before.
+     */
+    void forgetPitchWheels()
+    {
+        for(int& pitchWheel : lastPitchWheelSent) pitchWheel = ChannelAllocator::unknownPitchWheel;
+        channelAllocator.resetPitchWheels();
+    }
+    /**
+     Adds a pitch wheel message to the processed buffer, unless channel is already bent to pitchWheel.
+     */
+    void sendPitchWheel(int channel, int pitchWheel, int samplePosition)
+    {
+        if(lastPitchWheelSent[channel] == pitchWheel)
+        {
+            numPitchWheelsSaved.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        processedBuffer.addEvent(juce::MidiMessage::pitchWheel(channel, pitchWheel), samplePosition);
+        lastPitchWheelSent[channel] = pitchWheel;
+    }
+    /**
+     Sends the active snapshot's tuning (with the current modulation offset) as MTS SysEx.
+     After a modulation, only the notes whose pitch changed since the last tuning that was sent are sent, as real-time single note tuning changes.
+     Otherwise (or if nothing has been sent yet) a bulk tuning dump of every note is sent.
+     @param isModulation True if only the modulation offset changed.
+     @param samplePosition Where in the current block to send the tuning.
+     */
+    void sendMtsTuning(bool isModulation, int samplePosition)
+    {
+        if(activeSnapshot == nullptr || !activeSnapshot->hasSclLoaded()) return;
+        output.sendMtsTuning(getRetuneTable(), retuneOffset, activeSnapshot->getDescription(), isModulation, processedBuffer, samplePosition);
+    }
+    /**
+     Sends the MPE setup messages (if they haven't been sent yet), and the pitchbend of every bend class channel
+     in the active snapshot's static channel layout. After this, notes can be played without any pitch wheel messages.
+     A modulation moves every note by the same interval, so it keeps notes in the same bend classes, and only the pitchbends are sent again.
+     */
+    void sendStaticChannelLayout(int samplePosition)
+    {
+        if(!hasSentSetupMessages) sendSetupMessages();
+        
+        const TuningSnapshot::StaticChannelLayout& layout = activeSnapshot->getStaticChannelLayout();
+        for(int bendClass = 0; bendClass < layout.numBendClasses; bendClass++)
+        {
+            int channel = layout.bendClassChannels[bendClass];
+            int pitchWheel = retuneOffset == 0 ? layout.bendClassPitchWheels[bendClass] : getRetune(layout.bendClassNotes[bendClass]).pitchWheel;
+            glides.stop(channel);
+            sendPitchWheel(channel, pitchWheel, samplePosition);
+            channelAllocator.setPitchWheel(channel, pitchWheel);
+        }
+    }
+
+    void sendSetupMessages() {
+        processedBuffer.addEvents(setupMessages, 0, -1, 0);
+        hasSentSetupMessages = true;
+    }
+    
+    void makeSetupMessages() {
+        zoneLayout.setLowerZone(15, 1, 2);
+        zoneLayout.setUpperZone(0, 1, 2);
+        setupMessages.addEvents(juce::MPEMessages::setZoneLayout(zoneLayout),
+                                0, -1, 0);
+    }
+    void initMidiNoteChannelMap() {
+        midiNoteChannelMap.resize(128); //128, because there are 128 midi values
+        midiNoteChannelMap.fill(static_cast<juce::int8>(-1)); //nothing is currently being played
+        midiNoteOutputMap.resize(128);
+        midiNoteOutputMap.fill(static_cast<juce::int8>(-1));
+        allocatedNotes.reset();
+    }
+    
+    
+    /**
+     Moves message onto the channel and note number that its (input) note number is currently being played with.
+     */
+    void setChannelAndNoteNumber(juce::MidiMessage& message) {
+        auto noteNum = message.getNoteNumber();
+        message.setChannel(midiNoteChannelMap.getUnchecked(noteNum));
+        message.setNoteNumber(midiNoteOutputMap.getUnchecked(noteNum));
+    }
+    
+    
+    /**
+     @return false if the note isn't mapped, and shouldn't be added to the processed buffer.
+     */
+    bool processNoteOn(juce::MidiMessage& message, int samplePosition)
+    {
+        auto noteNum = message.getNoteNumber();
+        lastNotePlayed.store(noteNum, std::memory_order_relaxed);
+        const RetuneTable::Entry retune = getRetune(noteNum);
+        if(!retune.isMapped) return false;
+        
+        if(midiNoteChannelMap.getUnchecked(noteNum) == -1 && (output.isUsingMts() || output.isUsingUmp())) // the synth retunes the note itself, so it is played as is.
+        {
+            midiNoteChannelMap.set(noteNum, static_cast<juce::int8>(message.getChannel()));
+            midiNoteOutputMap.set(noteNum, static_cast<juce::int8>(noteNum));
+        }
+        else if(midiNoteChannelMap.getUnchecked(noteNum) == -1) // if the note is retriggered while held, it stays where it is.
+        {
+            auto assignment = activeSnapshot->hasStaticChannelLayout()
+                ? channelAllocator.assignToChannel(activeSnapshot->getStaticChannelLayout().channels[noteNum], retune.noteNumber, retune.pitchWheel)
+                : channelAllocator.findChannelForNewNote(retune.noteNumber, retune.pitchWheel);
+            if(assignment.notesReleased) releaseStolenNotes(assignment.channel, samplePosition);
+            midiNoteChannelMap.set(noteNum, static_cast<juce::int8>(assignment.channel));
+            midiNoteOutputMap.set(noteNum, retune.noteNumber);
+            allocatedNotes[noteNum] = true;
+            glides.stop(assignment.channel); // the channel was unknown while gliding, so the new note's bend is always sent
+            // a channel shared with notes of the same bend (within the allocator's tolerance) keeps its bend.
+            sendPitchWheel(assignment.channel,
+                           assignment.pitchWheelChanged ? retune.pitchWheel : channelAllocator.getPitchWheel(assignment.channel),
+                           samplePosition);
+        }
+        setChannelAndNoteNumber(message);
+        return true;
+    }
+    /**
+     Sends note offs for the notes on a channel that was stolen for a note with another bend, since they can't be bent with it.
+     The allocator has already released them, and their own note offs are dropped when they come.
+     */
+    void releaseStolenNotes(int channel, int samplePosition)
+    {
+        for(int noteNum = 0; noteNum < 128; noteNum++)
+        {
+            if(!allocatedNotes[noteNum] || midiNoteChannelMap.getUnchecked(noteNum) != channel) continue;
+            processedBuffer.addEvent(juce::MidiMessage::noteOff(channel, midiNoteOutputMap.getUnchecked(noteNum)), samplePosition);
+            allocatedNotes[noteNum] = false;
+            midiNoteChannelMap.set(noteNum, -1);
+            midiNoteOutputMap.set(noteNum, -1);
+        }
+    }
+    /**
+     @return false if the note isn't being played, and shouldn't be added to the processed buffer.
+     */
+    bool processNoteOff(juce::MidiMessage& message, int samplePosition)
+    {
+        auto noteNum = message.getNoteNumber();
+        juce::int8 channel = midiNoteChannelMap.getUnchecked(noteNum);
+        if(channel == -1) return false;
+        setChannelAndNoteNumber(message);
+            
+        if(allocatedNotes[noteNum]) channelAllocator.noteOff(channel, midiNoteOutputMap.getUnchecked(noteNum));
+        allocatedNotes[noteNum] = false;
+        midiNoteChannelMap.set(noteNum, -1);
+        midiNoteOutputMap.set(noteNum, -1);
+        return true;
+    }
+    void processAllNotesOff(juce::MidiMessage& message, int samplePosition)
+    {
+        channelAllocator.allNotesOff();
+        initMidiNoteChannelMap();
+        glides.stopAll();
+        forgetPitchWheels(); // a panic from the host usually resets the controllers too
+    }
+    /**
+     @return false if the note isn't being played, and shouldn't be added to the processed buffer.
+     */
+    bool processAftertouch(juce::MidiMessage& message, int samplePosition)
+    {
+        if(midiNoteChannelMap.getUnchecked(message.getNoteNumber()) == -1) return false;
+        setChannelAndNoteNumber(message);
+        return true;
+    }
+    
+    bool shouldAddMessage(const juce::MidiMessage& message)
+    {
+        return output.isUsingMts() || output.isUsingUmp() || !message.isPitchWheel(); // with MPE, pitch wheel messages would overwrite the retuning
+    }
+    /**
+     Adds a processed message to the output. With UMP output, note ons and note offs become MIDI 2.0 packets,
+     system common and real-time messages become system packets, and every other message is wrapped in a MIDI 1.0 packet.
+     */
+    void addProcessedMessage(const juce::MidiMessage& message, int samplePosition)
+    {
+        if(!output.isUsingUmp())
+        {
+            processedBuffer.addEvent(message, samplePosition);
+            return;
+        }
+        juce::uint32 words[ump::maxWordsPerPacket];
+        if(message.isNoteOn())
+        {
+            juce::uint32 pitch = getRetune(message.getNoteNumber()).pitch;
+            umpOutput.add(words, ump::writeNoteOnWithPitch(0, message.getChannel(), message.getNoteNumber(), message.getVelocity(), pitch, words), samplePosition);
+            juce::uint32 bend = ump::getResidualPitchBend(pitch, zoneLayout.getLowerZone().perNotePitchbendRange);
+            if(bend != ump::centeredPitchBend)
+            {
+                umpOutput.add(words, ump::writePerNotePitchBend(0, message.getChannel(), message.getNoteNumber(), bend, words), samplePosition);
+            }
+        }
+        else if(message.isNoteOff())
+        {
+            umpOutput.add(words, ump::writeNoteOff(0, message.getChannel(), message.getNoteNumber(), message.getVelocity(), words), samplePosition);
+        }
+        else if(message.getRawData()[0] >= 0xf1)
+        {
+            umpOutput.add(words, ump::writeSystem(0, message.getRawData(), message.getRawDataSize(), words), samplePosition);
+        }
+        else
+        {
+            umpOutput.add(words, ump::writeMidi1ChannelVoice(0, message.getRawData(), message.getRawDataSize(), words), samplePosition);
+        }
+    }
+    /**
+     @return true if buffer's storage is one that prepareToPlay() preallocated, so that it has room for a whole block of output.
+     */
+    bool hasOwnStorage(const juce::MidiBuffer& buffer) const
+    {
+        const juce::uint8* storage = buffer.data.begin();
+        return storage != nullptr && std::find(std::begin(ownStorage), std::end(ownStorage), storage) != std::end(ownStorage);
+    }
+    /**
+     Hands the output to the host by swapping processedBuffer's storage with the host's, since copying into the host's buffer would grow it
+     whenever there is more output than input. Storage that comes back from the host is only written to if it is one of the preallocated ones.
+     The host's own storage could be any size, so it is parked in a spare, and the spare's storage is written to instead.
+     Once every spare holds a host buffer's storage, the output is copied into any new host buffer, which may make it allocate.
+     */
+    void swapOutput(juce::MidiBuffer& midiMessages)
+    {
+        if(hasOwnStorage(midiMessages))
+        {
+            midiMessages.swapWith(processedBuffer);
+        }
+        else if(numSpareBuffersLeft > 0)
+        {
+            midiMessages.swapWith(processedBuffer);
+            processedBuffer.swapWith(spareBuffers[--numSpareBuffersLeft]);
+        }
+        else
+        {
+            midiMessages.clear();
+            midiMessages.addEvents(processedBuffer, 0, -1, 0);
+        }
+        processedBuffer.clear();
+    }
+
+public:
+    using OutputMode = OutputModeState::Mode;
+    
+    MidiProcessor(juce::UndoManager& um) : undoManager(um), scale(um), midiProcessorValues(IDs::midiProcessor)
+    {
+        makeSetupMessages();
+        initMidiNoteChannelMap();
+        for(int& pitchWheel : lastPitchWheelSent) pitchWheel = ChannelAllocator::unknownPitchWheel;
+        auto lowerZone = zoneLayout.getLowerZone();
+        channelAllocator.setChannelRange(lowerZone.getFirstMemberChannel(), lowerZone.getLastMemberChannel());
+        
+        midiProcessorValues.addChild(scale.scaleValues, -1, &undoManager);
+        
+        midiProcessorValues.setProperty(IDs::lastNotePlayed, -1, nullptr);
+        midiProcessorValues.setProperty(IDs::modCenter, 60, nullptr);
+        midiProcessorValues.setProperty(IDs::modPivot, 60, nullptr);
+
+    }
+    ~MidiProcessor()
+    {
+        releaseRetiredSnapshots();
+        if(auto* pending = pendingSnapshot.exchange(nullptr)) pending->decReferenceCount();
+        if(activeSnapshot != nullptr) activeSnapshot->decReferenceCount();
+    }
+    /**
+     Preallocates processedBuffer and spareBuffers, so that process() doesn't allocate. Call this before processing starts,
+     and whenever the block size or maxEventDensity changes.
+     @param newSampleRate The sample rate of the host.
+     @param newSamplesPerBlock The largest number of samples that will be in each block.
+     */
+    void prepareToPlay(double newSampleRate, int newSamplesPerBlock)
+    {
+        sampleRate = newSampleRate;
+        samplesPerBlock = newSamplesPerBlock;
+        glides.setSampleRate(sampleRate);
+        const int maxGlideBendsPerChannel = glides.getMaxBendsPerChannel(samplesPerBlock);
+        const auto size = static_cast<size_t>(getMaxEventsPerBlock(samplesPerBlock) * maxOutputEventsPerInputEvent * maxBytesPerEvent
+                                              + setupMessages.data.size() + (1 + maxModulationsPerBlock) * 16 * maxBytesPerEvent //room for sendStaticChannelLayout()
+                                              + mts::bulkDumpSize + maxBytesPerEvent + maxModulationsPerBlock * 2 * (mts::maxSingleNoteChangeSize + maxBytesPerEvent) //room for sendMtsTuning()
+                                              + 16 * maxGlideBendsPerChannel * maxBytesPerEvent); //room for processGlides()
+        // the host may still have storage from before the resize, so only the storage allocated here counts as preallocated
+        processedBuffer.clear();
+        processedBuffer.ensureSize(size);
+        ownStorage[0] = processedBuffer.data.begin();
+        for(int i = 0; i < numSpareBuffers; i++)
+        {
+            spareBuffers[i] = juce::MidiBuffer();
+            spareBuffers[i].ensureSize(size);
+            ownStorage[i + 1] = spareBuffers[i].data.begin();
+        }
+        numSpareBuffersLeft = numSpareBuffers;
+        forgetPitchWheels(); // the host may have reset the synth
+        shouldSyncModulateParameter.store(true);
+        umpOutput.clear();
+        umpOutput.ensureSize(getMaxEventsPerBlock(samplesPerBlock) * maxOutputEventsPerInputEvent);
+    }
+    /**
+     Sets the most input midi events per sample that process() can handle without allocating. This takes effect on the next call to prepareToPlay().
+     @param eventsPerSample The maximum event density. Ex: 0.5 means that a block of 32 samples can contain 16 events.
+     */
+    void setMaxEventDensity(double eventsPerSample) { maxEventDensity = eventsPerSample; }
+    double getMaxEventDensity() const { return maxEventDensity; }
+    int getMaxEventsPerBlock(int samplesPerBlock) const
+    {
+        return juce::jmax(minEventsPerBlock, static_cast<int>(std::ceil(samplesPerBlock * maxEventDensity)));
+    }
+    
+    /**
+     @param shouldPool If true, notes that need the same pitchbend share a channel, so polyphony isn't limited to 15 notes.
+     If false, each note gets its own channel when possible (ex: for synths that use MPE for per-note expression).
+     */
+    void setPoolChannelsByBend(bool shouldPool) { poolChannelsByBend.store(shouldPool); }
+    /**
+     If the tuning has 15 or fewer distinct pitchbends, each one is given its own channel when the tuning is published.
+     The channels are bent once (after loading or modulating) and notes are played without any pitch wheel messages.
+     Tunings with more bend classes fall back to assigning channels note by note.
+     Must be called on the message thread.
+     */
+    void setUseStaticChannelLayout(bool shouldUse)
+    {
+        useStaticChannelLayout = shouldUse;
+        publishTuning();
+    }
+    /**
+     Switches between MPE, MTS, and UMP output. In MTS mode, a bulk tuning dump is sent when a tuning is loaded,
+     and only the notes that changed are sent after a modulation. In UMP mode, every note on carries its own pitch.
+     In both, notes stay on their original channel and note number.
+     Must be called on the message thread. Notes that are held while the mode changes are released as they were played.
+     */
+    void setOutputMode(OutputMode newMode)
+    {
+        output.setMode(newMode);
+        publishTuning();
+    }
+    OutputMode getOutputMode() const { return output.getMode(); }
+    /**
+     @param shouldRetune If true, notes that are held through a modulation are bent to the new tuning (in MPE output).
+     Otherwise only new notes use the new tuning. MTS output always retunes held notes.
+     */
+    void setRetuneHeldNotes(bool shouldRetune) { glides.setRetuneHeldNotes(shouldRetune); }
+    /**
+     @param milliseconds How long held notes take to glide to a new tuning. 0 retunes them in the same block as the modulation.
+     */
+    void setGlideTime(float milliseconds) { glides.setGlideTime(milliseconds); }
+    /**
+     Limits how often a glide sends pitch wheel messages, so that gliding every channel at once doesn't overload the midi link or the synth.
+     @param milliseconds The shortest time between two pitch wheel messages on the same channel. Clamped to at least 1ms.
+     */
+    void setMinTimeBetweenBends(float milliseconds) { glides.setMinTimeBetweenBends(milliseconds); }
+    /**
+     @return How many pitch wheel messages weren't sent because their channel was already bent to the same position.
+     */
+    juce::int64 getNumPitchWheelsSaved() const { return numPitchWheelsSaved.load(std::memory_order_relaxed); }    
+    /**
+     Lets the host drive modulation, the reference frequency, and the morph between the unmodulated and modulated tunings.
+     Must be called before processing starts. See HostParameters.
+     */
+    void setHostParameters(const HostParameters& parameters) { hostParameters = parameters; }
+    /**
+     Reserves a range of keys for triggering modulations from the midi stream. Reserved keys aren't played.
+     Holding one reserved key and pressing another modulates from the held key (the center) to the pressed key (the pivot),
+     at the sample position of the pressed key. Keys of a periodic scale repeat every period, so the reserved keys can stand for any register.
+     @param lowestKey The lowest reserved key, or -1 to not reserve any keys.
+     @param highestKey The highest reserved key.
+     */
+    void setModulationKeyRange(int lowestKey, int highestKey) { modulationTriggers.setKeyRange(lowestKey, highestKey); }
+    /**
+     @param controllerNumber A controller that modulates from the current center to the current pivot (or the host's, see setHostParameters()) when it rises to 64 or above,
+     or -1 to not trigger modulations from a controller. Messages from the controller aren't passed through.
+     */
+    void setModulationController(int controllerNumber) { modulationTriggers.setController(controllerNumber); }
+    /**
+     @param shouldReset If true, program changes return to the unmodulated tuning (and aren't passed through),
+     so a sequence that starts with a program change modulates the same way on every render.
+     */
+    void setProgramChangeResetsModulation(bool shouldReset) { modulationTriggers.setProgramChangeResets(shouldReset); }
+    /**
+     Function for processing Midi messages. Using a .scl file, it retunes the message using MPE and pitchbend.
+     @param midiMessages The MIDI buffer sent from  PluginProcessor::processBlock. Contains all MIDI for processing.
+     This doesn't allocate, as long as prepareToPlay() has been called, and there are no more events than the maximum event density allows.
+     @param numSamples The number of samples in the block, used to time glides. If -1, the block size from prepareToPlay() is used.
+     */
+    void process(juce::MidiBuffer& midiMessages, int numSamples = -1)
+    {
+        MICROMOD_SCOPED_NO_ALLOCATIONS;
+
+//        processedBuffer.clear();
+//        if(!hasSentSetupMessages) sendSetupMessages();
+        if(output.beginBlock()) forgetPitchWheels();
+        umpOutput.clear();
+        numRetunesInBlock = 0;
+        updateActiveSnapshot();
+        if(output.isUsingMts() && !output.hasSentMtsTuning()) sendMtsTuning(false, 0); // the mode changed, with no new snapshot yet
+        updateModulationOffset();
+        processHostParameters();
+        channelAllocator.setPoolByBend(poolChannelsByBend.load(std::memory_order_relaxed));
+        
+        if(activeSnapshot != nullptr && activeSnapshot->hasSclLoaded()) //if no scl has been loaded, skip all processing
+        {
+            juce::MidiMessage message;
+            for(const juce::MidiMessageMetadata metadata : midiMessages)
+            {
+                if(metadata.numBytes > 3) // copying sysex into a juce::MidiMessage would allocate, so pass it through as raw data.
+                {
+                    processedBuffer.addEvent(metadata.data, metadata.numBytes, metadata.samplePosition);
+                    continue;
+                }
+                message = metadata.getMessage();
+                if(processModulationTrigger(message, metadata.samplePosition)) continue;
+                bool shouldAdd = shouldAddMessage(message);
+                
+                if(message.isNoteOn()) shouldAdd = processNoteOn(message, metadata.samplePosition);
+                if(message.isNoteOff()) shouldAdd = processNoteOff(message, metadata.samplePosition);
+                if(message.isAllNotesOff()) processAllNotesOff(message, metadata.samplePosition);
+                if(message.isResetAllControllers()) forgetPitchWheels();
+                if(message.isAftertouch()) shouldAdd = processAftertouch(message, metadata.samplePosition);
+
+                if(shouldAdd && message.isPitchWheel()) lastPitchWheelSent[message.getChannel()] = message.getPitchWheelValue(); // passed through in MTS or UMP output
+                if(shouldAdd) addProcessedMessage(message, metadata.samplePosition);
+            }
+        }
+        
+        sendDeferredRetune();
+        processGlides(numSamples < 0 ? samplesPerBlock : numSamples);
+
+        swapOutput(midiMessages);
+    }
+    
+    /**
+     Compiles the current state of scale into a new TuningSnapshot, and hands it to the audio thread.
+     Must be called on the message thread whenever the .scl or .kbm changes. Modulations only need publishModulation().
+     The audio thread starts using it at the beginning of the next call to process().
+     */
+    void publishTuning()
+    {
+        releaseRetiredSnapshots();
+        
+        snapshotGeneration = ++publishSerial;
+        auto* snapshot = new TuningSnapshot(scale, zoneLayout.getLowerZone(), useStaticChannelLayout, snapshotGeneration);
+        snapshot->incReferenceCount(); //this reference belongs to pendingSnapshot, then activeSnapshot.
+        if(auto* unused = pendingSnapshot.exchange(snapshot))
+        {
+            unused->decReferenceCount(); //the audio thread never picked this one up, so we can release it here.
+        }
+        publishModulation();
+    }
+    /**
+     Hands scale's modulation offset to the audio thread. This is constant time, and doesn't allocate.
+     Must be called on the message thread.
+     */
+    void publishModulation()
+    {
+        requestedModulation.store(packModulation(++publishSerial, RetuneTable::toFixedOffset(scale.getModulationOffset())));
+    }
+    /**
+     Copies modulationHistory's offset into scale, and hands it to the audio thread.
+     */
+    void applyModulationHistory()
+    {
+        scale.setModulationOffset(static_cast<double>(modulationHistory.getOffset()) / RetuneTable::fixedPointSemitone);
+        publishModulation();
+    }
+    /**
+     Sets the center and pivot back to the ones a step was made with. Steps from the midi stream don't have them.
+     */
+    void restoreModulationNotes(const ModulationHistory::Step& step)
+    {
+        if(step.center < 0 || step.pivot < 0) return;
+        setCenter(static_cast<int>(step.center));
+        setPivot(static_cast<int>(step.pivot));
+    }
+    /**
+     Copies the modulations that were triggered from the midi stream into scale, so that the UI and the undo history see them.
+     Each one is its own step in the history, unless more than ModulationTriggers::maxReportedModulations were triggered since the last call.
+     Must be called on the message thread. PluginProcessor calls this periodically from a timer.
+     */
+    void publishStreamModulations()
+    {
+        modulationTriggers.publishReported([this](juce::int64 packed) { publishStreamModulation(packed); });
+    }
+    void publishStreamModulation(juce::int64 packed)
+    {
+        if(unpackSerial(packed) != (snapshotGeneration & 0xffff)) return; // the tuning has been replaced since
+        juce::int64 offset = unpackOffset(packed);
+        if(offset == modulationHistory.getOffset()) return;
+        modulationHistory.push(offset - modulationHistory.getOffset(), -1, -1);
+        scale.setModulationOffset(static_cast<double>(offset) / RetuneTable::fixedPointSemitone);
+    }
+    /**
+     Publishes a tuning that replaces the old one (ex: a new .scl or .kbm, or undoLoad()), and clears the modulation history,
+     since its steps were made on the old tuning.
+     */
+    void publishNewTuning()
+    {
+        modulationHistory.clear(RetuneTable::toFixedOffset(scale.getModulationOffset()));
+        publishTuning();
+    }
+    /**
+     Releases snapshots that the audio thread has stopped using. Must not be called on the audio thread.
+     PluginProcessor calls this periodically from a timer.
+     */
+    void releaseRetiredSnapshots()
+    {
+        int start1, size1, start2, size2;
+        retiredSnapshotsFifo.prepareToRead(retiredSnapshotsFifo.getNumReady(), start1, size1, start2, size2);
+        for(int i = 0; i < size1; i++) retiredSnapshots[start1 + i]->decReferenceCount();
+        for(int i = 0; i < size2; i++) retiredSnapshots[start2 + i]->decReferenceCount();
+        retiredSnapshotsFifo.finishedRead(size1 + size2);
+    }
+    
+    /**
+     Loads a .scl file into scale, and publishes the new tuning.
+     @param sclFile The .scl file to load.
+     @return true if the file was loaded.
+     */
+    bool loadSclFile(juce::File sclFile)
+    {
+        bool output = scale.loadSclFile(sclFile);
+        if(output) publishNewTuning();
+        return output;
+    }
+    bool loadSclString(std::string_view sclString)
+    {
+        bool output = scale.loadSclString(sclString);
+        if(output) publishNewTuning();
+        return output;
+    }
+    /**
+     Loads a .kbm file into scale, and publishes the new tuning.
+     @param kbmFile The .kbm file to load.
+     @return true if the file was loaded.
+     */
+    bool loadKbmFile(juce::File kbmFile)
+    {
+        bool output = scale.loadKbmFile(kbmFile);
+        if(output) publishNewTuning();
+        return output;
+    }
+    bool loadKbmString(std::string_view kbmString)
+    {
+        bool output = scale.loadKbmString(kbmString);
+        if(output) publishNewTuning();
+        return output;
+    }
+    /**
+     Loads a .scl or .kbm entry of a ScalePack into scale, and publishes the new tuning.
+     @param pack The pack to load from. See ScalePack::open().
+     @param name The name of the entry, ex: "12edo.scl".
+     @return true if the entry was found and loaded.
+     */
+    bool loadFromScalePack(const ScalePack& pack, std::string_view name)
+    {
+        bool output = scale.loadFromScalePack(pack, pack.findEntry(name));
+        if(output) publishNewTuning();
+        return output;
+    }
+    /**
+     Undoes the last .scl or .kbm load, and publishes the tuning it replaced. Like a load, this starts the tuning unmodulated
+     and clears the modulation history. Modulations are undone with undo().
+     @return false if there was no load to undo.
+     */
+    bool undoLoad()
+    {
+        if(!scale.undo()) return false;
+        publishNewTuning();
+        return true;
+    }
+    /**
+     Loads the last tuning that undoLoad() undid again, and publishes it. See undoLoad().
+     @return false if there was no load to redo.
+     */
+    bool redoLoad()
+    {
+        if(!scale.redo()) return false;
+        publishNewTuning();
+        return true;
+    }
+    
+    /**
+    Sets the center for modulation.
+    @param newCenter. The juce::int8 representation of a Midi Note to set  modulation center to.
+    */
+    void setCenter(juce::var newCenter)
+    {
+        midiProcessorValues.setProperty(IDs::modCenter, newCenter, nullptr); //see modulationHistory
+        syncModulationNotes();
+    }
+   /**
+    Sets the center for modulation to the last midiNote that was played.
+    */
+    void setCenter()
+    {
+        setCenter(getLastNotePlayed());
+        
+    }
+    /**
+     Sets the pivot for modulation.
+     @param newPivot. The juce::int8 representation of a Midi Note to set  modulation pivot to.
+     */
+    void setPivot(juce::var newPivot)
+    {
+        midiProcessorValues.setProperty(IDs::modPivot, newPivot, nullptr);
+        syncModulationNotes();
+    }
+    /**
+     Copies the center and pivot into atomics, so controller triggers can read them on the audio thread.
+     */
+    void syncModulationNotes()
+    {
+        juce::var centerVar = midiProcessorValues.getProperty(IDs::modCenter);
+        juce::var pivotVar = midiProcessorValues.getProperty(IDs::modPivot);
+        modulationTriggers.setCenterAndPivot(centerVar.isInt() ? static_cast<int>(centerVar) : -1, pivotVar.isInt() ? static_cast<int>(pivotVar) : -1);
+    }
+    /**
+     Sets the pivot for modulation to the last midiNote that was played.
+     */
+    void setPivot()
+    {
+        setPivot(getLastNotePlayed());
+    }
+    
+    /**
+     @return The last midi note number that was played, or -1 if no notes have been played. Safe to call from any thread.
+     */
+    int getLastNotePlayed() const { return lastNotePlayed.load(std::memory_order_relaxed); }
+    /**
+     Copies the last note played into midiProcessorValues, so that listeners (ex: the UI) are updated.
+     Must be called on the message thread. This isn't added to the undo history.
+     */
+    void publishLastNotePlayed()
+    {
+        int note = getLastNotePlayed();
+        if(static_cast<int>(midiProcessorValues.getProperty(IDs::lastNotePlayed)) != note)
+        {
+            midiProcessorValues.setProperty(IDs::lastNotePlayed, note, nullptr);
+        }
+    }
+    
+    /**
+     Modulates scale from the center to the pivot if both are set, and adds the step to modulationHistory.
+     */
+    void modulate()
+    {
+        publishStreamModulations(); // so this modulation starts from wherever the midi stream left the tuning
+        juce::var pivotVar = midiProcessorValues.getProperty(IDs::modPivot);
+        juce::var centerVar = midiProcessorValues.getProperty(IDs::modCenter);
+        
+        if(pivotVar.isInt() && centerVar.isInt()){
+            int pivot = pivotVar;
+            int center = centerVar;
+            if((pivot >= 0)
+               && (pivot < 128)
+               && (center >= 0)
+               && (center < 128)
+               )
+            {
+                double interval = scale.getModulationInterval(center, pivot);
+                if(center == pivot || std::isnan(interval)) return; //nothing to modulate, or one of them isn't mapped
+                modulationHistory.push(RetuneTable::toFixedOffset(interval), center, pivot);
+                applyModulationHistory();
+            }
+        }
+    }
+    
+    /**
+     @return The tuning, center, pivot, and modulation, for saving with the host's project. Must be called on the message thread.
+     The host parameters are left empty, for the caller to fill in.
+     */
+    PluginState getState()
+    {
+        publishStreamModulations();
+        PluginState state;
+        state.hasScl = scale.hasSclLoaded();
+        state.description = scale.getDescription();
+        state.noteRatios = scale.getNoteRatios();
+        
+        KeyboardMap& kbm = scale.getKeyboardMap();
+        state.kbm.retuneRangeLowerBound = kbm.getRetuneRangeLowerBound();
+        state.kbm.retuneRangeUpperBound = kbm.getRetuneRangeUpperBound();
+        state.kbm.middleNote = kbm.getMiddleNote();
+        state.kbm.referenceNote = kbm.getReferenceMidiNote();
+        state.kbm.referenceFreq = kbm.getReferenceFreq();
+        state.kbm.formalOctaveScaleDegree = kbm.getFormalOctaveScaleDegree();
+        state.kbm.mapping.assign(kbm.getScaleDegrees().begin(), kbm.getScaleDegrees().end());
+        
+        juce::var centerVar = midiProcessorValues.getProperty(IDs::modCenter);
+        juce::var pivotVar = midiProcessorValues.getProperty(IDs::modPivot);
+        state.center = centerVar.isInt() ? static_cast<int>(centerVar) : -1;
+        state.pivot = pivotVar.isInt() ? static_cast<int>(pivotVar) : -1;
+        
+        state.historyBaseOffset = modulationHistory.getBaseOffset();
+        for(juce::int64 step = modulationHistory.getFirstPosition(); step < modulationHistory.getLastPosition(); step++)
+        {
+            state.historySteps.push_back(modulationHistory.getStep(step));
+        }
+        state.historyPosition = modulationHistory.getPosition() - modulationHistory.getFirstPosition();
+        return state;
+    }
+    /**
+     Restores a state from getState(), without reading or parsing any files, and publishes the tuning.
+     The modulation history is restored with it. Must be called on the message thread, after the host parameters are restored,
+     so that a modulate parameter that was saved on doesn't modulate again on top of the restored history.
+     @return false if the saved tuning couldn't be loaded. The center and pivot are still restored.
+     */
+    bool setState(const PluginState& state)
+    {
+        bool output = true;
+        if(state.hasScl)
+        {
+            scala::SclData scl;
+            scl.isValid = true;
+            scl.description = state.description;
+            scl.notes.assign(state.noteRatios.begin(), state.noteRatios.end());
+            output = scale.loadScl(scl) && scale.loadKbm(state.kbm);
+        }
+        setCenter(state.center);
+        setPivot(state.pivot);
+        modulationHistory.clear(output ? state.historyBaseOffset : 0);
+        if(output)
+        {
+            for(const auto& step : state.historySteps) modulationHistory.push(step.offsetDelta, step.center, step.pivot);
+            auto numUndone = static_cast<juce::int64>(state.historySteps.size()) - state.historyPosition;
+            modulationHistory.jumpTo(modulationHistory.getLastPosition() - numUndone); //counted from the end, in case a smaller cap dropped the oldest steps
+        }
+        scale.setModulationOffset(static_cast<double>(modulationHistory.getOffset()) / RetuneTable::fixedPointSemitone);
+        undoManager.clearUndoHistory(); //the loads before the state was restored belong to another session
+        shouldSyncModulateParameter.store(true);
+        publishTuning();
+        return output;
+    }
+    
+    /**
+     Steps back over the last modulation, and sets the center and pivot back to the ones it was made with.
+     Constant time, whatever the length of the history.
+     */
+    void undo()
+    {
+        publishStreamModulations(); // so a modulation from the midi stream can be undone too
+        if(!modulationHistory.canUndo()) return;
+        restoreModulationNotes(modulationHistory.getStep(modulationHistory.getPosition() - 1));
+        modulationHistory.undo();
+        applyModulationHistory();
+    }
+    /**
+     Applies the last undone modulation again. Constant time.
+     */
+    void redo()
+    {
+        publishStreamModulations();
+        if(!modulationHistory.canRedo()) return;
+        restoreModulationNotes(modulationHistory.getStep(modulationHistory.getPosition()));
+        modulationHistory.redo();
+        applyModulationHistory();
+    }
+    /**
+     Moves to any step of the modulation history, ex: to recall a point earlier in a set.
+     @param position A position from modulationHistory.getFirstPosition() to modulationHistory.getLastPosition().
+     */
+    void jumpTo(juce::int64 position)
+    {
+        publishStreamModulations();
+        modulationHistory.jumpTo(position);
+        applyModulationHistory();
+    }
+    /**
+     Sets the most memory the modulation history can use. This clears the history.
+     */
+    void setMaxHistoryBytes(size_t maxBytes) { modulationHistory.setMaxBytes(maxBytes); }
+    
+    /**
+     @return The tuning that is loaded. Load and modulate through MidiProcessor, so that the audio thread gets the changes.
+     */
+    Scale& getScale() { return scale; }
+    const ModulationHistory& getModulationHistory() const { return modulationHistory; }
+    /**
+     @return The output of the last call to process() in OutputMode::ump. SysEx is still passed through in midiMessages.
+     */
+    const ump::PacketBuffer& getUmpOutput() const { return umpOutput; }
+    
+    juce::ValueTree midiProcessorValues;
+};
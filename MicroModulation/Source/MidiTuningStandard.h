@@ -0,0 +1,128 @@
+/*
+ ==============================================================================
+
+ MidiTuningStandard.h
+
+ A namespace of functions for building MIDI Tuning Standard (MTS) SysEx messages.
+ These are used by MidiProcessor as an alternative to MPE + pitchbend, for synths that support MTS.
+ Every function writes into a caller-provided buffer, so they can be used on the audio thread.
+ See: https://www.midi.org/specifications-old/item/the-midi-1-0-specification (MIDI Tuning Standard)
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <string>
+
+#include "JuceHeader.h"
+
+#include "RetuneTable.h"
+
+namespace mts {
+
+static constexpr int bytesPerNote = 3;          // xx yy zz: semitone, then the 14-bit fraction of a semitone above it
+static constexpr int tuningNameLength = 16;
+static constexpr int bulkDumpSize = 6 + tuningNameLength + RetuneTable::numMidiNotes * bytesPerNote + 2; // F0 7E id 08 01 tt, name, data, checksum F7
+static constexpr int maxChangesPerMessage = 127;
+static constexpr int singleNoteChangeHeaderSize = 7;    // F0 7F id 08 02 tt ll
+static constexpr int maxSingleNoteChangeSize = singleNoteChangeHeaderSize + maxChangesPerMessage * (1 + bytesPerNote) + 1; // + F7
+static constexpr juce::uint8 allDevices = 0x7f;
+
+/**
+ Encodes a pitch into the 3 byte MTS frequency format.
+ @param pitch The pitch, as a 7.25 fixed point midi note number (see RetuneTable::Entry::pitch).
+ @param isMapped If false, the "no change" value (7F 7F 7F) is written.
+ @param dest Where to write the 3 bytes.
+ */
+inline void encodePitch(juce::uint32 pitch, bool isMapped, juce::uint8* dest)
+{
+    if(!isMapped)
+    {
+        dest[0] = dest[1] = dest[2] = 0x7f;
+        return;
+    }
+    constexpr int droppedBits = RetuneTable::pitchFractionBits - 14; // MTS has a 14 bit fraction
+    juce::uint32 rounded = juce::jmin((pitch >> droppedBits) + ((pitch >> (droppedBits - 1)) & 1u),
+                                      (127u << 14) | 16382u); // 7F 7F 7F is reserved for "no change"
+    int semitone = static_cast<int>(rounded >> 14);
+    int fraction = static_cast<int>(rounded & 0x3fff);
+    dest[0] = static_cast<juce::uint8>(semitone);
+    dest[1] = static_cast<juce::uint8>((fraction >> 7) & 0x7f);
+    dest[2] = static_cast<juce::uint8>(fraction & 0x7f);
+}
+
+/**
+ Encodes every note in table into the 3 byte MTS frequency format, moved by a modulation offset (see RetuneTable::transpose()).
+ @param offset The fixed point offset to add to every pitch.
+ @param dest Where to write RetuneTable::numMidiNotes * bytesPerNote bytes.
+ */
+inline void encodeTable(const RetuneTable& table, juce::int64 offset, juce::uint8* dest)
+{
+    for(int note = 0; note < RetuneTable::numMidiNotes; note++)
+    {
+        RetuneTable::Entry entry = RetuneTable::transpose(table[note], offset, 1.0f);
+        encodePitch(entry.pitch, entry.isMapped, dest + note * bytesPerNote);
+    }
+}
+
+/**
+ Writes a (non-real-time) bulk tuning dump of all 128 notes.
+ @param noteData 128 * bytesPerNote bytes of encoded pitches, from encodeTable().
+ @param name The name of the tuning. Only the first 16 (7-bit) characters are used.
+ @param program The tuning program number, on [0, 127].
+ @param dest Where to write bulkDumpSize bytes.
+ @return The number of bytes written.
+ */
+inline int writeBulkTuningDump(const juce::uint8* noteData, const std::string& name, int program, juce::uint8* dest)
+{
+    int size = 0;
+    dest[size++] = 0xf0;
+    dest[size++] = 0x7e;
+    dest[size++] = allDevices;
+    dest[size++] = 0x08;
+    dest[size++] = 0x01;
+    dest[size++] = static_cast<juce::uint8>(program & 0x7f);
+    for(int i = 0; i < tuningNameLength; i++)
+    {
+        dest[size++] = i < static_cast<int>(name.size()) ? static_cast<juce::uint8>(name[i] & 0x7f) : ' ';
+    }
+    for(int i = 0; i < RetuneTable::numMidiNotes * bytesPerNote; i++) dest[size++] = noteData[i];
+    
+    juce::uint8 checksum = 0;
+    for(int i = 1; i < size; i++) checksum ^= dest[i]; //from 7E up to the last data byte
+    dest[size++] = checksum & 0x7f;
+    dest[size++] = 0xf7;
+    return size;
+}
+
+/**
+ Writes a real-time single note tuning change for some of the notes. This takes effect immediately, even on sounding notes.
+ @param noteData 128 * bytesPerNote bytes of encoded pitches, from encodeTable().
+ @param notes The midi note numbers to retune.
+ @param numNotes The number of notes in notes, on [1, maxChangesPerMessage].
+ @param program The tuning program number, on [0, 127].
+ @param dest Where to write (at most) maxSingleNoteChangeSize bytes.
+ @return The number of bytes written.
+ */
+inline int writeSingleNoteTuningChange(const juce::uint8* noteData, const int* notes, int numNotes, int program, juce::uint8* dest)
+{
+    jassert(numNotes > 0 && numNotes <= maxChangesPerMessage);
+    int size = 0;
+    dest[size++] = 0xf0;
+    dest[size++] = 0x7f;
+    dest[size++] = allDevices;
+    dest[size++] = 0x08;
+    dest[size++] = 0x02;
+    dest[size++] = static_cast<juce::uint8>(program & 0x7f);
+    dest[size++] = static_cast<juce::uint8>(numNotes);
+    for(int i = 0; i < numNotes; i++)
+    {
+        dest[size++] = static_cast<juce::uint8>(notes[i]);
+        for(int b = 0; b < bytesPerNote; b++) dest[size++] = noteData[notes[i] * bytesPerNote + b];
+    }
+    dest[size++] = 0xf7;
+    return size;
+}
+
+}  // end namespace mts
@@ -0,0 +1,164 @@
+/*
+ ==============================================================================
+
+ ModulationHistory.h
+
+ A bounded history of modulations, for undo, redo, and jumping back to any earlier step.
+ Each step is stored as a delta: the fixed point offset it added (see RetuneTable::toFixedOffset()) and the
+ center and pivot it was made with. Steps are kept in a ring buffer, so when the memory cap is reached the oldest
+ step is folded into the starting offset and dropped. Deltas are integers, so undoing and redoing is exact.
+
+ Steps are numbered from the first modulation since clear(). A position is the number of steps that are applied,
+ so position p is the tuning after step p - 1. Every checkpointInterval steps the absolute offset is kept as well,
+ so jumpTo() adds up at most checkpointInterval deltas, however long the history is.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "JuceHeader.h"
+
+class ModulationHistory
+{
+public:
+    struct Step
+    {
+        juce::int64 offsetDelta; // the fixed point offset the step added
+        juce::int8 center;       // -1 if the step didn't come from a center and pivot (ex: a reset from the midi stream)
+        juce::int8 pivot;
+    };
+    static constexpr size_t defaultMaxBytes = 64 * 1024;
+    static constexpr juce::int64 checkpointInterval = 32;
+
+    /**
+     @param maxBytes The most memory the steps (and their checkpoints) can use. At least one step is always kept.
+     */
+    explicit ModulationHistory(size_t maxBytes = defaultMaxBytes) { setMaxBytes(maxBytes); }
+
+    /**
+     Changes the memory cap. This clears the history, keeping the current offset as the starting offset.
+     */
+    void setMaxBytes(size_t maxBytes)
+    {
+        constexpr size_t bytesPerStep = sizeof(Step) + sizeof(juce::int64) / checkpointInterval + 1;
+        juce::int64 offset = getOffset();
+        steps.assign(juce::jmax(static_cast<size_t>(1), maxBytes / bytesPerStep), Step());
+        checkpoints.assign(steps.size() / static_cast<size_t>(checkpointInterval) + 2, 0);
+        clear(offset);
+    }
+    /**
+     Removes every step. Used when a new tuning is loaded, since the steps only make sense for the tuning they were made on.
+     @param startOffset The offset before the first step.
+     */
+    void clear(juce::int64 startOffset = 0)
+    {
+        firstStep = endStep = position = 0;
+        baseOffset = currentOffset = startOffset;
+        checkpoints[0] = startOffset;
+    }
+    /**
+     Adds a step after the current position. Steps that were undone are discarded, so they can no longer be redone.
+     If the history is full, the oldest step is dropped.
+     */
+    void push(juce::int64 offsetDelta, int center, int pivot)
+    {
+        endStep = position;
+        if(endStep - firstStep == getCapacity()) //fold the oldest step into the starting offset
+        {
+            baseOffset += getStep(firstStep).offsetDelta;
+            firstStep++;
+        }
+        steps[getRingIndex(endStep)] = {offsetDelta, static_cast<juce::int8>(center), static_cast<juce::int8>(pivot)};
+        endStep++;
+        position = endStep;
+        currentOffset += offsetDelta;
+        if(endStep % checkpointInterval == 0) checkpoints[getCheckpointIndex(endStep)] = currentOffset;
+    }
+
+    bool canUndo() const { return position > firstStep; }
+    bool canRedo() const { return position < endStep; }
+    /**
+     Steps back over the last applied step, in constant time.
+     @return The offset after undoing, or the current offset if there is nothing to undo.
+     */
+    juce::int64 undo()
+    {
+        if(!canUndo()) return currentOffset;
+        position--;
+        currentOffset -= getStep(position).offsetDelta;
+        return currentOffset;
+    }
+    /**
+     Applies the next undone step again, in constant time.
+     @return The offset after redoing, or the current offset if there is nothing to redo.
+     */
+    juce::int64 redo()
+    {
+        if(!canRedo()) return currentOffset;
+        currentOffset += getStep(position).offsetDelta;
+        position++;
+        return currentOffset;
+    }
+    /**
+     Moves to any position between getFirstPosition() and getLastPosition(), starting from the nearest checkpoint.
+     Steps after the new position can still be redone.
+     @return The offset at the new position.
+     */
+    juce::int64 jumpTo(juce::int64 newPosition)
+    {
+        newPosition = juce::jlimit(firstStep, endStep, newPosition);
+        juce::int64 checkpoint = (newPosition / checkpointInterval) * checkpointInterval;
+        juce::int64 from = checkpoint;
+        juce::int64 offset = checkpoints[getCheckpointIndex(checkpoint)];
+        if(checkpoint < firstStep) //the checkpoint's steps have been dropped, so start from the oldest step instead
+        {
+            from = firstStep;
+            offset = baseOffset;
+        }
+        for(juce::int64 step = from; step < newPosition; step++) offset += getStep(step).offsetDelta;
+        position = newPosition;
+        currentOffset = offset;
+        return currentOffset;
+    }
+
+    /**
+     @return The offset at the current position.
+     */
+    juce::int64 getOffset() const { return currentOffset; }
+    juce::int64 getPosition() const { return position; }
+    juce::int64 getFirstPosition() const { return firstStep; }
+    juce::int64 getLastPosition() const { return endStep; }
+    /**
+     @return The offset before the oldest step that is still kept.
+     */
+    juce::int64 getBaseOffset() const { return baseOffset; }
+    /**
+     @param stepNumber A step from getFirstPosition() to getLastPosition() - 1.
+     */
+    const Step& getStep(juce::int64 stepNumber) const
+    {
+        jassert(stepNumber >= firstStep && stepNumber < endStep);
+        return steps[getRingIndex(stepNumber)];
+    }
+    /**
+     @return The most steps that are kept before the oldest is dropped.
+     */
+    juce::int64 getCapacity() const { return static_cast<juce::int64>(steps.size()); }
+    size_t getMemoryUsage() const { return steps.size() * sizeof(Step) + checkpoints.size() * sizeof(juce::int64); }
+
+private:
+    std::vector<Step> steps;               // a ring buffer of the steps from firstStep to endStep
+    std::vector<juce::int64> checkpoints;  // the offset at each position that is a multiple of checkpointInterval
+    juce::int64 firstStep = 0, endStep = 0, position = 0;
+    juce::int64 baseOffset = 0;            // the offset at firstStep
+    juce::int64 currentOffset = 0;         // the offset at position
+
+    size_t getRingIndex(juce::int64 stepNumber) const { return static_cast<size_t>(stepNumber % getCapacity()); }
+    size_t getCheckpointIndex(juce::int64 stepNumber) const
+    {
+        return static_cast<size_t>((stepNumber / checkpointInterval) % static_cast<juce::int64>(checkpoints.size()));
+    }
+};
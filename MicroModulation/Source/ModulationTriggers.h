@@ -0,0 +1,137 @@
+/*
+ ==============================================================================
+
+ ModulationTriggers.h
+
+ Recognises the midi messages that trigger modulations from inside the midi stream: a pair of reserved keys,
+ a controller crossing 64, or (optionally) a program change. The settings are atomics that the message thread sets,
+ and process() is called on the audio thread, in the order of the midi stream.
+
+ The audio thread reports each modulation it applies with reportModulation(), and the message thread
+ reads them back with publishReported(), so every one of them can get its own step in the modulation history.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "JuceHeader.h"
+
+class ModulationTriggers
+{
+public:
+    enum class TriggerType
+    {
+        none,       // not a trigger. The message is played as usual
+        ignored,    // a trigger (or reserved key) that doesn't modulate. The message isn't played
+        keys,       // modulates from the held reserved key (center) to the pressed one (pivot)
+        controller, // modulates from the current center to the current pivot
+        reset       // returns to the unmodulated tuning
+    };
+    struct Trigger
+    {
+        TriggerType type;
+        int center, pivot; // for TriggerType::keys
+    };
+    static constexpr int maxReportedModulations = 64;
+
+    /**
+     @param lowestKey The lowest reserved key, or -1 to not reserve any keys.
+     @param highestKey The highest reserved key.
+     */
+    void setKeyRange(int lowestKey, int highestKey)
+    {
+        keyHigh.store(highestKey);
+        keyLow.store(lowestKey);
+    }
+    /**
+     @param controllerNumber The controller that triggers modulations, or -1.
+     */
+    void setController(int controllerNumber) { controller.store(controllerNumber); }
+    void setProgramChangeResets(bool shouldReset) { programChangeResets.store(shouldReset); }
+    /**
+     Sets the center and pivot of controller triggers (copies of the modCenter and modPivot properties). -1 if one isn't set.
+     */
+    void setCenterAndPivot(int newCenter, int newPivot)
+    {
+        center.store(newCenter);
+        pivot.store(newPivot);
+    }
+    int getCenter() const { return center.load(std::memory_order_relaxed); }
+    int getPivot() const { return pivot.load(std::memory_order_relaxed); }
+
+    /**
+     Works out whether message is a trigger. Called on the audio thread.
+     @param isNotePlaying True if message is a note off for a note that is being played (ex: it was played before the key was reserved).
+     */
+    Trigger process(const juce::MidiMessage& message, bool isNotePlaying)
+    {
+        if(message.isNoteOnOrOff())
+        {
+            int note = message.getNoteNumber();
+            int low = keyLow.load(std::memory_order_relaxed);
+            if(low < 0 || note < low || note > keyHigh.load(std::memory_order_relaxed)) return { TriggerType::none, -1, -1 };
+            if(message.isNoteOff() && isNotePlaying) return { TriggerType::none, -1, -1 };
+
+            if(message.isNoteOff()) heldKey = note == heldKey ? -1 : heldKey;
+            else if(heldKey == -1) heldKey = note;
+            else return { TriggerType::keys, heldKey, note };
+            return { TriggerType::ignored, -1, -1 };
+        }
+        if(message.isController() && message.getControllerNumber() == controller.load(std::memory_order_relaxed))
+        {
+            bool wasOn = isControllerOn;
+            isControllerOn = message.getControllerValue() >= 64;
+            return { isControllerOn && !wasOn ? TriggerType::controller : TriggerType::ignored, -1, -1 };
+        }
+        if(message.isProgramChange() && programChangeResets.load(std::memory_order_relaxed)) return { TriggerType::reset, -1, -1 };
+        return { TriggerType::none, -1, -1 };
+    }
+
+    /**
+     Reports a modulation that the audio thread applied. If the message thread has fallen more than maxReportedModulations behind,
+     the modulations since are only reported as the last of them.
+     @param packed The modulation, packed however the caller likes (see MidiProcessor::packModulation()).
+     */
+    void reportModulation(juce::int64 packed)
+    {
+        lastReported.store(packed);
+        if(reportedFifo.getFreeSpace() == 0)
+        {
+            hasDroppedReports.store(true);
+            return;
+        }
+        int start1, size1, start2, size2;
+        reportedFifo.prepareToWrite(1, start1, size1, start2, size2);
+        reported[size1 > 0 ? start1 : start2] = packed;
+        reportedFifo.finishedWrite(size1 + size2);
+    }
+    /**
+     Calls publish(packed) for each modulation that was reported since the last call, oldest first. Called on the message thread.
+     */
+    template <typename Publish>
+    void publishReported(Publish&& publish)
+    {
+        int start1, size1, start2, size2;
+        reportedFifo.prepareToRead(reportedFifo.getNumReady(), start1, size1, start2, size2);
+        for(int i = 0; i < size1; i++) publish(reported[start1 + i]);
+        for(int i = 0; i < size2; i++) publish(reported[start2 + i]);
+        reportedFifo.finishedRead(size1 + size2);
+        if(hasDroppedReports.exchange(false)) publish(lastReported.load());
+    }
+
+private:
+    std::atomic<int> keyLow { -1 }, keyHigh { -1 }; // the reserved keys. -1 if no keys are reserved
+    std::atomic<int> controller { -1 };
+    std::atomic<bool> programChangeResets { false };
+    std::atomic<int> center { 60 }, pivot { 60 };
+    int heldKey = -1; // the reserved key that is the center of the next key modulation, or -1. only used by the audio thread
+    bool isControllerOn = false; // only used by the audio thread, so a controller only triggers when it crosses 64
+
+    juce::AbstractFifo reportedFifo { maxReportedModulations };
+    juce::int64 reported[maxReportedModulations];
+    std::atomic<juce::int64> lastReported { 0 }; // the newest reported modulation
+    std::atomic<bool> hasDroppedReports { false }; // set when the fifo was full, so the modulations since are published as one step
+};
@@ -0,0 +1,109 @@
+/*
+ ==============================================================================
+
+ OutputModeState.h
+
+ Which output mode MidiProcessor retunes with, and the state of MTS output.
+ The mode is set on the message thread and read once at the start of each block by beginBlock(),
+ so a block never changes mode halfway through. MTS tunings are encoded into fixed size arrays,
+ so sendMtsTuning() never allocates.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#include "JuceHeader.h"
+
+#include "MidiTuningStandard.h"
+#include "RetuneTable.h"
+
+class OutputModeState
+{
+public:
+    /**
+     How retuned notes are sent to the synth.
+     */
+    enum class Mode
+    {
+        mpe, // notes are spread across MPE member channels, and bent with pitch wheel messages
+        mts, // notes pass through unchanged, and the synth is retuned with MIDI Tuning Standard SysEx
+        ump  // notes pass through unchanged, as MIDI 2.0 packets with per-note pitch (see MidiProcessor::getUmpOutput())
+    };
+
+    void setMode(Mode newMode) { requestedMode.store(static_cast<int>(newMode)); }
+    Mode getMode() const { return static_cast<Mode>(requestedMode.load()); }
+
+    /**
+     Reads the mode for the block about to be processed. Called on the audio thread at the start of each block.
+     @return true if the mode changed since the last block.
+     */
+    bool beginBlock()
+    {
+        const bool wasUsingMts = usingMts, wasUsingUmp = usingUmp;
+        usingMts = getMode() == Mode::mts;
+        usingUmp = getMode() == Mode::ump;
+        if(!usingMts) hasSentTuning = false;
+        return usingMts != wasUsingMts || usingUmp != wasUsingUmp;
+    }
+    bool isUsingMts() const { return usingMts; }
+    bool isUsingUmp() const { return usingUmp; }
+    /**
+     @return true once a bulk tuning dump has been sent since MTS output started.
+     */
+    bool hasSentMtsTuning() const { return hasSentTuning; }
+
+    /**
+     Sends a tuning as MTS SysEx. After a modulation, only the notes whose pitch changed since the last tuning that was sent
+     are sent, as real-time single note tuning changes. Otherwise (or if nothing has been sent yet) a bulk tuning dump of every note is sent.
+     @param table The tuning to send.
+     @param offset The fixed point offset to move every note by (see RetuneTable::transpose()).
+     @param description The name of the tuning, for the bulk tuning dump.
+     @param isModulation True if only the offset changed since the last tuning that was sent.
+     @param buffer Where to add the messages.
+     @param samplePosition Where in the current block to send the tuning.
+     */
+    void sendMtsTuning(const RetuneTable& table, juce::int64 offset, const std::string& description, bool isModulation,
+                       juce::MidiBuffer& buffer, int samplePosition)
+    {
+        mts::encodeTable(table, offset, noteData);
+
+        if(!hasSentTuning || !isModulation)
+        {
+            int size = mts::writeBulkTuningDump(noteData, description, 0, message);
+            buffer.addEvent(message, size, samplePosition);
+            std::memcpy(sentNoteData, noteData, sizeof(noteData));
+            hasSentTuning = true;
+            return;
+        }
+
+        int changedNotes[RetuneTable::numMidiNotes];
+        int numChangedNotes = 0;
+        for(int note = 0; note < RetuneTable::numMidiNotes; note++)
+        {
+            if(std::memcmp(sentNoteData + note * mts::bytesPerNote, noteData + note * mts::bytesPerNote, mts::bytesPerNote) != 0)
+            {
+                changedNotes[numChangedNotes++] = note;
+            }
+        }
+        for(int start = 0; start < numChangedNotes; start += mts::maxChangesPerMessage)
+        {
+            int size = mts::writeSingleNoteTuningChange(noteData, changedNotes + start,
+                                                        juce::jmin(mts::maxChangesPerMessage, numChangedNotes - start), 0, message);
+            buffer.addEvent(message, size, samplePosition);
+        }
+        std::memcpy(sentNoteData, noteData, sizeof(noteData));
+    }
+
+private:
+    std::atomic<int> requestedMode { static_cast<int>(Mode::mpe) };
+    bool usingMts = false, usingUmp = false; // the mode of the current block. only used by the audio thread
+    bool hasSentTuning = false; // true once a bulk tuning dump has been sent
+    juce::uint8 noteData[RetuneTable::numMidiNotes * mts::bytesPerNote];     // scratch space for sendMtsTuning()
+    juce::uint8 sentNoteData[RetuneTable::numMidiNotes * mts::bytesPerNote]; // the tuning the synth was last sent
+    juce::uint8 message[juce::jmax(mts::bulkDumpSize, mts::maxSingleNoteChangeSize)]; // scratch space for sendMtsTuning()
+};
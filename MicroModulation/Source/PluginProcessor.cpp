@@ -1,179 +1,235 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-
-//==============================================================================
-MicroModulationAudioProcessor::MicroModulationAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       ),
-        apvst(*this, nullptr, "Parameters", createParameters()), midiProcessor(undoManager)
-#endif
-{
-}
-
-MicroModulationAudioProcessor::~MicroModulationAudioProcessor()
-{
-}
-
-//==============================================================================
-const juce::String MicroModulationAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool MicroModulationAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool MicroModulationAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool MicroModulationAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double MicroModulationAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int MicroModulationAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int MicroModulationAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void MicroModulationAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String MicroModulationAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void MicroModulationAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void MicroModulationAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-}
-
-void MicroModulationAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool MicroModulationAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void MicroModulationAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    buffer.clear();
-    midiProcessor.process(midiMessages);
-}
-
-//==============================================================================
-bool MicroModulationAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* MicroModulationAudioProcessor::createEditor()
-{
-    return new MicroModulationAudioProcessorEditor (*this);
-}
-
-//==============================================================================
-void MicroModulationAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-}
-
-void MicroModulationAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new MicroModulationAudioProcessor();
-}
-
-
-juce::AudioProcessorValueTreeState::ParameterLayout MicroModulationAudioProcessor::createParameters()
-{
-    std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
-    
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("GAIN", "Gain", 0.0f, 1.0f, 0.5f));
-    return {params.begin(), params.end()};
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+
+//==============================================================================
+MicroModulationAudioProcessor::MicroModulationAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       ),
+        apvst(*this, nullptr, "Parameters", createParameters()), midiProcessor(undoManager), lastSyncedCenter(60), lastSyncedPivot(60)
+#endif
+{
+    MidiProcessor::HostParameters parameters;
+    parameters.center = apvst.getRawParameterValue(IDs::centerParameter);
+    parameters.pivot = apvst.getRawParameterValue(IDs::pivotParameter);
+    parameters.modulate = apvst.getRawParameterValue(IDs::modulateParameter);
+    parameters.referenceFreq = apvst.getRawParameterValue(IDs::referenceFreqParameter);
+    parameters.morph = apvst.getRawParameterValue(IDs::morphParameter);
+    midiProcessor.setHostParameters(parameters);
+    startTimerHz(30);
+}
+
+MicroModulationAudioProcessor::~MicroModulationAudioProcessor()
+{
+    stopTimer();
+}
+
+//==============================================================================
+const juce::String MicroModulationAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool MicroModulationAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool MicroModulationAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool MicroModulationAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double MicroModulationAudioProcessor::getTailLengthSeconds() const
+{
+    return 0.0;
+}
+
+int MicroModulationAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int MicroModulationAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void MicroModulationAudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const juce::String MicroModulationAudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void MicroModulationAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+}
+
+//==============================================================================
+void MicroModulationAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // Use this method as the place to do any pre-playback
+    // initialisation that you need..
+    midiProcessor.prepareToPlay(sampleRate, samplesPerBlock);
+}
+
+void MicroModulationAudioProcessor::releaseResources()
+{
+    // When playback stops, you can use this as an opportunity to free up any
+    // spare memory, etc.
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool MicroModulationAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // This is the place where you check if the layout is supported.
+    // In this template code we only support mono or stereo.
+    // Some plugin hosts, such as certain GarageBand versions, will only
+    // load plugins that support stereo bus layouts.
+    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
+     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void MicroModulationAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    MICROMOD_SCOPED_NO_ALLOCATIONS;
+    buffer.clear();
+    midiProcessor.process(midiMessages, buffer.getNumSamples());
+}
+
+//==============================================================================
+bool MicroModulationAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* MicroModulationAudioProcessor::createEditor()
+{
+    return new MicroModulationAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void MicroModulationAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    PluginState state = midiProcessor.getState();
+    for(juce::AudioProcessorParameter* parameter : getParameters())
+    {
+        state.parameters.push_back(static_cast<juce::RangedAudioParameter*>(parameter)->getValue());
+    }
+    state.writeTo(destData);
+}
+
+void MicroModulationAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    PluginState state;
+    if(!state.readFrom(data, sizeInBytes)) return; // corrupted or unknown state. keep the default state
+    
+    const juce::Array<juce::AudioProcessorParameter*>& parameters = getParameters();
+    for(int i = 0; i < juce::jmin(parameters.size(), static_cast<int>(state.parameters.size())); i++) //parameters added since the state was saved keep their defaults
+    {
+        parameters.getUnchecked(i)->setValueNotifyingHost(state.parameters[static_cast<size_t>(i)]);
+    }
+    midiProcessor.setState(state); //after the parameters, so a restored modulate parameter doesn't modulate again
+    lastSyncedCenter = state.center;
+    lastSyncedPivot = state.pivot;
+}
+
+void MicroModulationAudioProcessor::timerCallback()
+{
+    midiProcessor.publishLastNotePlayed();
+    midiProcessor.publishStreamModulations();
+    syncModulationParameter(IDs::centerParameter, IDs::modCenter, lastSyncedCenter);
+    syncModulationParameter(IDs::pivotParameter, IDs::modPivot, lastSyncedPivot);
+    midiProcessor.releaseRetiredSnapshots();
+}
+
+void MicroModulationAudioProcessor::syncModulationParameter(const juce::Identifier& parameterID, const juce::Identifier& property, int& lastSynced)
+{
+    int parameterValue = juce::roundToInt(apvst.getRawParameterValue(parameterID)->load());
+    juce::var propertyValue = midiProcessor.midiProcessorValues.getProperty(property);
+    if(parameterValue != lastSynced)
+    {
+        lastSynced = parameterValue;
+        midiProcessor.midiProcessorValues.setProperty(property, parameterValue, nullptr); //automation isn't added to the undo history
+        midiProcessor.syncModulationNotes();
+    }
+    else if(propertyValue.isInt() && static_cast<int>(propertyValue) != parameterValue)
+    {
+        lastSynced = juce::jlimit(0, 127, static_cast<int>(propertyValue));
+        juce::RangedAudioParameter* parameter = apvst.getParameter(parameterID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(lastSynced)));
+    }
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new MicroModulationAudioProcessor();
+}
+
+
+juce::AudioProcessorValueTreeState::ParameterLayout MicroModulationAudioProcessor::createParameters()
+{
+    std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
+    
+    params.push_back(std::make_unique<juce::AudioParameterInt>(IDs::centerParameter.toString(), "Modulation Center", 0, 127, 60));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(IDs::pivotParameter.toString(), "Modulation Pivot", 0, 127, 60));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(IDs::modulateParameter.toString(), "Modulate", false)); //modulates each time it turns on
+    juce::NormalisableRange<float> referenceFreqRange(220.0f, 880.0f);
+    referenceFreqRange.setSkewForCentre(440.0f);
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(IDs::referenceFreqParameter.toString(), "Reference Frequency", referenceFreqRange, 440.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(IDs::morphParameter.toString(), "Tuning Morph", 0.0f, 1.0f, 1.0f));
+    return {params.begin(), params.end()};
+}
@@ -1,68 +1,81 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-#include "MidiProcessor.h"
-
-
-//==============================================================================
-/**
-*/
-class MicroModulationAudioProcessor  : public juce::AudioProcessor
-{
-public:
-    //==============================================================================
-    MicroModulationAudioProcessor();
-    ~MicroModulationAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-
-    //BEGIN USER WRITTEN CODE
-    juce::AudioProcessorValueTreeState apvst;
-    juce::UndoManager undoManager;
-    MidiProcessor midiProcessor;
-    
-private:
-    juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MicroModulationAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "MidiProcessor.h"
+
+
+//==============================================================================
+/**
+*/
+class MicroModulationAudioProcessor  : public juce::AudioProcessor, private juce::Timer
+{
+public:
+    //==============================================================================
+    MicroModulationAudioProcessor();
+    ~MicroModulationAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    //BEGIN USER WRITTEN CODE
+    juce::AudioProcessorValueTreeState apvst;
+    juce::UndoManager undoManager;
+    MidiProcessor midiProcessor;
+    
+private:
+    juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
+    
+    int lastSyncedCenter, lastSyncedPivot; // the center and pivot parameter values the last time they were synced with midiProcessorValues
+    /**
+     Keeps a center or pivot parameter and its midiProcessorValues property (shown in the UI) the same.
+     If the host moved the parameter, the property is updated. Otherwise, if the property changed (ex: "Set Center"), the host is told.
+     */
+    void syncModulationParameter(const juce::Identifier& parameterID, const juce::Identifier& property, int& lastSynced);
+    
+    /**
+     Publishes audio thread state (ex: the last note played) to the ValueTree, syncs the center and pivot parameters,
+     and releases tuning snapshots that the audio thread is done with.
+     */
+    void timerCallback() override;
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MicroModulationAudioProcessor)
+};
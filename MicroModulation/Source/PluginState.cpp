@@ -0,0 +1,131 @@
+/*
+ ==============================================================================
+
+ PluginState.cpp
+
+ ==============================================================================
+ */
+
+#include "PluginState.h"
+#include "RetuneTable.h"
+
+void PluginState::writeTo(juce::MemoryBlock& dest) const
+{
+    juce::MemoryOutputStream payload;
+    payload.writeBool(hasScl);
+    payload.writeInt(static_cast<int>(description.size()));
+    payload.write(description.data(), description.size());
+    payload.writeInt(static_cast<int>(noteRatios.size()));
+    for(double ratio : noteRatios) payload.writeDouble(ratio);
+
+    payload.writeInt(kbm.retuneRangeLowerBound);
+    payload.writeInt(kbm.retuneRangeUpperBound);
+    payload.writeInt(kbm.middleNote);
+    payload.writeInt(kbm.referenceNote);
+    payload.writeFloat(kbm.referenceFreq);
+    payload.writeInt(kbm.formalOctaveScaleDegree);
+    payload.writeInt(static_cast<int>(kbm.mapping.size()));
+    for(int scaleDegree : kbm.mapping) payload.writeShort(static_cast<short>(scaleDegree));
+
+    payload.writeInt(center);
+    payload.writeInt(pivot);
+    payload.writeInt64(historyBaseOffset);
+    payload.writeInt(static_cast<int>(historySteps.size()));
+    for(const auto& step : historySteps)
+    {
+        payload.writeInt64(step.offsetDelta);
+        payload.writeByte(static_cast<char>(step.center));
+        payload.writeByte(static_cast<char>(step.pivot));
+    }
+    payload.writeInt64(historyPosition);
+    payload.writeInt(static_cast<int>(parameters.size()));
+    for(float value : parameters) payload.writeFloat(value);
+
+    juce::MemoryOutputStream out(dest, false);
+    out.writeInt(static_cast<int>(magic));
+    out.writeInt(static_cast<int>(version));
+    out.writeInt(static_cast<int>(payload.getDataSize()));
+    out.writeInt(static_cast<int>(makeChecksum(payload.getData(), payload.getDataSize())));
+    out.write(payload.getData(), payload.getDataSize());
+}
+
+bool PluginState::readFrom(const void* data, int sizeInBytes)
+{
+    if(data == nullptr || sizeInBytes < headerSize) return false;
+    juce::MemoryInputStream in(data, static_cast<size_t>(sizeInBytes), false);
+    if(static_cast<juce::uint32>(in.readInt()) != magic) return false;
+    auto blobVersion = static_cast<juce::uint32>(in.readInt());
+    if(blobVersion < 1 || blobVersion > version) return false;
+    auto payloadSize = static_cast<juce::uint32>(in.readInt());
+    auto checksum = static_cast<juce::uint32>(in.readInt());
+    if(payloadSize != static_cast<juce::uint32>(sizeInBytes - headerSize)) return false;
+    if(makeChecksum(static_cast<const char*>(data) + headerSize, payloadSize) != checksum) return false;
+
+    // the checksum matched, but lengths are still checked against what is left, so a bad writer can't make this read past the end
+    auto isLengthValid = [&in](int length, int bytesPerItem) { return length >= 0 && static_cast<juce::int64>(length) * bytesPerItem <= in.getNumBytesRemaining(); };
+
+    PluginState state;
+    state.hasScl = in.readBool();
+    int descriptionLength = in.readInt();
+    if(!isLengthValid(descriptionLength, 1)) return false;
+    state.description.resize(static_cast<size_t>(descriptionLength));
+    in.read(state.description.data(), descriptionLength);
+    int numNotes = in.readInt();
+    if(!isLengthValid(numNotes, sizeof(double))) return false;
+    state.noteRatios.resize(static_cast<size_t>(numNotes));
+    for(double& ratio : state.noteRatios) ratio = in.readDouble();
+
+    state.kbm.retuneRangeLowerBound = in.readInt();
+    state.kbm.retuneRangeUpperBound = in.readInt();
+    state.kbm.middleNote = in.readInt();
+    state.kbm.referenceNote = in.readInt();
+    state.kbm.referenceFreq = in.readFloat();
+    state.kbm.formalOctaveScaleDegree = in.readInt();
+    int mappingSize = in.readInt();
+    if(!isLengthValid(mappingSize, sizeof(short))) return false;
+    state.kbm.mapping.resize(static_cast<size_t>(mappingSize));
+    for(int& scaleDegree : state.kbm.mapping) scaleDegree = in.readShort();
+    state.kbm.isValid = true;
+
+    state.center = in.readInt();
+    state.pivot = in.readInt();
+    if(blobVersion == 1)
+    {
+        state.historyBaseOffset = RetuneTable::toFixedOffset(in.readDouble()); // the modulation offset, in semitones
+    }
+    else
+    {
+        state.historyBaseOffset = in.readInt64();
+        int numSteps = in.readInt();
+        if(!isLengthValid(numSteps, sizeof(juce::int64) + 2)) return false;
+        state.historySteps.resize(static_cast<size_t>(numSteps));
+        for(auto& step : state.historySteps)
+        {
+            step.offsetDelta = in.readInt64();
+            step.center = static_cast<juce::int8>(in.readByte());
+            step.pivot = static_cast<juce::int8>(in.readByte());
+        }
+        state.historyPosition = in.readInt64();
+        if(state.historyPosition < 0 || state.historyPosition > numSteps) return false;
+    }
+    int numParameters = in.readInt();
+    if(!isLengthValid(numParameters, sizeof(float))) return false;
+    state.parameters.resize(static_cast<size_t>(numParameters));
+    for(float& value : state.parameters) value = in.readFloat();
+    if(in.getNumBytesRemaining() != 0) return false;
+
+    *this = std::move(state);
+    return true;
+}
+
+juce::uint32 PluginState::makeChecksum(const void* data, size_t size)
+{
+    juce::uint32 hash = 2166136261u;
+    const auto* bytes = static_cast<const juce::uint8*>(data);
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,61 @@
+/*
+ ==============================================================================
+
+ PluginState.h
+
+ Everything the plugin saves with a host's project, as a compact binary blob.
+ The tuning is stored already parsed (note ratios and a keyboard map), so restoring a session never reads
+ or parses a Scala file.
+
+ The layout (every value is little-endian):
+   Header   magic "MMST", version, size of the payload in bytes, checksum of the payload     4 x uint32
+   Payload  the fields of PluginState, in the order they are declared. Strings and arrays start with their length.
+ A blob whose magic, size, or checksum doesn't match, or that is from a newer version, is rejected as a whole, so a corrupted state
+ falls back to the default state instead of loading half a tuning. Blobs from older versions are upgraded as they are read.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "ModulationHistory.h"
+#include "ScalaParser.h"
+
+struct PluginState
+{
+    static constexpr juce::uint32 magic = 0x54534d4d; // "MMST", read as a little-endian uint32
+    static constexpr juce::uint32 version = 2; // 2 replaced the modulation offset with the modulation history
+    static constexpr int headerSize = 16;
+
+    bool hasScl = false;
+    std::string description;
+    std::vector<double> noteRatios;  // the ratio of each note of the scale to the tonic
+    scala::KbmData kbm;              // the keyboard map. isValid and error aren't saved
+    int center = 60;
+    int pivot = 60;
+    juce::int64 historyBaseOffset = 0;                   // see ModulationHistory::getBaseOffset(). The modulation offset is rebuilt from the history
+    std::vector<ModulationHistory::Step> historySteps;   // the steps that were kept, oldest first
+    juce::int64 historyPosition = 0;                     // the number of historySteps that are applied
+    std::vector<float> parameters;   // the host parameter values, in the order MicroModulationAudioProcessor::createParameters() adds them
+
+    /**
+     Replaces dest with the binary blob of this state.
+     */
+    void writeTo(juce::MemoryBlock& dest) const;
+    /**
+     Reads a blob written by writeTo(), by this version or an older one. Nothing is changed unless the whole blob is valid.
+     A version 1 blob has no history, so its modulation offset becomes the base offset of an empty history.
+     @return false if the blob is too short, from a newer version, or fails its checksum.
+     */
+    bool readFrom(const void* data, int sizeInBytes);
+
+    /**
+     @return The FNV-1a hash of size bytes of data.
+     */
+    static juce::uint32 makeChecksum(const void* data, size_t size);
+};
@@ -0,0 +1,154 @@
+/*
+ ==============================================================================
+
+ RetuneTable.h
+
+ A precompiled lookup table that stores how each of the 128 input midi notes should be played back.
+ Each entry holds the exact pitch of the note in 7.25 fixed point (the MIDI 2.0 per-note pitch format),
+ whether the input note is mapped at all, and the MIDI 1.0 note number and 14-bit pitchwheel position
+ that the pitch is quantized to for MPE output.
+ The table is compiled from a Scale whenever the .scl or .kbm changes, so that
+ MidiProcessor::process() only needs to index into it. Modulations aren't compiled into the table.
+ They are a fixed point offset that transpose() adds to an entry when it is looked up.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "JuceHeader.h"
+
+#include "Scale.h"
+#include "utils.h"
+
+struct RetuneTable
+{
+    struct Entry
+    {
+        juce::int8 noteNumber;   // the midi note number to play back
+        juce::uint16 pitchWheel; // 14-bit pitchwheel position. 8192 is centered.
+        bool isMapped;           // false if the input note has no frequency (ex: 'x' in a .kbm), and shouldn't be played.
+        juce::uint32 pitch;      // the exact pitch, as a 7.25 fixed point midi note number. Only meaningful if the note is mapped.
+    };
+
+    static constexpr int numMidiNotes = 128;
+    static constexpr int pitchFractionBits = 25;
+    static constexpr juce::uint32 fixedPointSemitone = 1u << pitchFractionBits;
+    Entry entries[numMidiNotes];
+
+    RetuneTable() { clear(); }
+
+    const Entry& operator[](int midiNoteNum) const { return entries[midiNoteNum]; }
+
+    /**
+     Resets every note to an unmapped state.
+     */
+    void clear()
+    {
+        for(int i = 0; i < numMidiNotes; i++)
+        {
+            entries[i] = makeUnmappedEntry(i);
+        }
+    }
+
+    /**
+     Fills the table using the (unmodulated) pitches of scale.
+     @param scale The Scale to get frequencies from. If it has no .scl loaded, the table will be cleared.
+     @param pitchbendRange The pitchbend range (in semitones) of the receiving synth.
+     */
+    void compile(Scale& scale, float pitchbendRange)
+    {
+        if(!scale.hasSclLoaded())
+        {
+            clear();
+            return;
+        }
+        for(int i = 0; i < numMidiNotes; i++)
+        {
+            entries[i] = makeEntryFromPitch(i, scale.getUnmodulatedPitch(static_cast<juce::int8>(i)), pitchbendRange);
+        }
+    }
+    
+    /**
+     @param midiPitch A fractional midi note number.
+     @return midiPitch in 7.25 fixed point, clamped to [0, 128).
+     */
+    static juce::uint32 toFixedPitch(double midiPitch)
+    {
+        double clamped = juce::jlimit(0.0, static_cast<double>(numMidiNotes), midiPitch);
+        auto fixed = static_cast<juce::uint64>(std::llround(clamped * fixedPointSemitone));
+        return static_cast<juce::uint32>(juce::jmin(fixed, static_cast<juce::uint64>(0xffffffffu)));
+    }
+    static double toMidiPitch(juce::uint32 fixedPitch) { return static_cast<double>(fixedPitch) / fixedPointSemitone; }
+    /**
+     @param semitones An interval, ex: Scale::getModulationOffset().
+     @return semitones in 25 bit fixed point, unclamped, so it can be added to an Entry's pitch.
+     */
+    static juce::int64 toFixedOffset(double semitones) { return static_cast<juce::int64>(std::llround(semitones * fixedPointSemitone)); }
+    /**
+     Moves an entry by a fixed point offset. This is how modulations are applied, so that they never need the table to be compiled again.
+     Only uses integer math and toPitchWheel(), so it can be called on the audio thread.
+     @param entry The entry to move. If it isn't mapped, it is returned as is.
+     @param offset The interval to move by, from toFixedOffset().
+     @param pitchbendRange The pitchbend range (in semitones) of the receiving synth.
+     @return The moved entry. It is unmapped if its pitch falls outside of [0, 127].
+     */
+    static Entry transpose(const Entry& entry, juce::int64 offset, float pitchbendRange)
+    {
+        if(!entry.isMapped || offset == 0) return entry;
+        juce::int64 pitch = static_cast<juce::int64>(entry.pitch) + offset;
+        if(pitch < 0) return { entry.noteNumber, 8192, false, entry.pitch };
+        juce::int64 noteNumber = (pitch + fixedPointSemitone / 2) >> pitchFractionBits; //rounds to the nearest note
+        if(noteNumber > 127) return { entry.noteNumber, 8192, false, entry.pitch };
+        auto fixedPitch = static_cast<juce::uint32>(pitch);
+        return { static_cast<juce::int8>(noteNumber), toPitchWheel(fixedPitch, static_cast<int>(noteNumber), pitchbendRange), true, fixedPitch };
+    }
+    /**
+     Quantizes a fixed point pitch to a MIDI 1.0 pitchwheel position, relative to noteNumber. This is the only place the pitch loses precision.
+     Bends larger than pitchbendRange are clamped to it.
+     @param fixedPitch The exact pitch in 7.25 fixed point.
+     @param noteNumber The midi note number that will be bent.
+     @param pitchbendRange The pitchbend range (in semitones) of the receiving synth.
+     */
+    static juce::uint16 toPitchWheel(juce::uint32 fixedPitch, int noteNumber, float pitchbendRange)
+    {
+        auto bend = static_cast<juce::int64>(fixedPitch) - (static_cast<juce::int64>(noteNumber) << pitchFractionBits);
+        auto semitones = juce::jlimit(-pitchbendRange, pitchbendRange, static_cast<float>(static_cast<double>(bend) / fixedPointSemitone));
+        return static_cast<juce::uint16>(juce::MidiMessage::pitchbendToPitchwheelPos(semitones, pitchbendRange));
+    }
+
+    /**
+     Splits a frequency into a midi note number and a pitchwheel position.
+     @param midiNoteNum The input midi note. Used as the output note if freq can't be played.
+     @param freq The frequency in Hz that midiNoteNum should sound at.
+     @param pitchbendRange The pitchbend range (in semitones) of the receiving synth.
+     */
+    static Entry makeEntry(int midiNoteNum, double freq, float pitchbendRange)
+    {
+        if(!(freq > 0.0) || !std::isfinite(freq)) return makeUnmappedEntry(midiNoteNum);
+        return makeEntryFromPitch(midiNoteNum, utils::freqToMidi(freq, 440.0), pitchbendRange);
+    }
+    /**
+     Splits a pitch into a midi note number and a pitchwheel position. Unlike makeEntry(), this doesn't need a log2.
+     @param midiNoteNum The input midi note. Used as the output note if midiPitch can't be played.
+     @param midiPitch The fractional midi note number that midiNoteNum should sound at (see Scale::getPitch()). NaN if it is unmapped.
+     @param pitchbendRange The pitchbend range (in semitones) of the receiving synth.
+     */
+    static Entry makeEntryFromPitch(int midiNoteNum, double midiPitch, float pitchbendRange)
+    {
+        if(!std::isfinite(midiPitch)) return makeUnmappedEntry(midiNoteNum);
+
+        double roundedMidiNoteNum = std::round(midiPitch);
+        if(roundedMidiNoteNum < 0 || roundedMidiNoteNum > 127) return makeUnmappedEntry(midiNoteNum);
+
+        auto pitch = toFixedPitch(midiPitch);
+        auto noteNumber = static_cast<int>(roundedMidiNoteNum);
+        return { static_cast<juce::int8>(noteNumber), toPitchWheel(pitch, noteNumber, pitchbendRange), true, pitch };
+    }
+    static Entry makeUnmappedEntry(int midiNoteNum)
+    {
+        return { static_cast<juce::int8>(midiNoteNum), 8192, false, static_cast<juce::uint32>(midiNoteNum) << pitchFractionBits };
+    }
+};
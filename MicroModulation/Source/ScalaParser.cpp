@@ -0,0 +1,196 @@
+/*
+ ==============================================================================
+
+ ScalaParser.cpp
+
+ ==============================================================================
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include "Intervals.h"
+#include "ScalaParser.h"
+#include "utils.h"
+
+namespace scala {
+
+/**
+ Splits text into lines, one at a time. Handles both '\n' and '\r\n' line breaks.
+ */
+class LineReader
+{
+public:
+    LineReader(std::string_view t) : text(t), position(0) {}
+
+    /**
+     @param line Set to a view of the next line in the text, without the '\n'. It is only valid as long as the text is.
+     @return false if there are no lines left.
+     */
+    bool getNextLine(std::string_view& line)
+    {
+        if(position >= text.size()) return false;
+        size_t end = text.find('\n', position);
+        if(end == std::string_view::npos) end = text.size();
+        line = text.substr(position, end - position);
+        position = end + 1;
+        return true;
+    }
+
+private:
+    std::string_view text;
+    size_t position;
+};
+
+/**
+ Marks data as invalid, with an error message.
+ */
+template <typename Data>
+static Data& invalid(Data& data, int lineNum, const std::string& error)
+{
+    data.isValid = false;
+    data.error = error + " (line " + std::to_string(lineNum) + ")";
+    return data;
+}
+
+SclData parseScl(std::string_view sclText)
+{
+    SclData data;
+    LineReader reader(sclText);
+    std::string_view rawLine;
+    std::string line; // reused for every line, so it only allocates when a line is longer than any before it
+    int lineNum = 0; // counts the lines that aren't blank or comments
+    try
+    {
+        int numNotesToRead = -1;
+        while(reader.getNextLine(rawLine))
+        {
+            if(lineNum == 0 && utils::isBlank(rawLine)) //handles files with empty descriptions.
+            {
+                data.description = "";
+                lineNum++;
+            }
+
+            std::string_view trimmedLine = utils::trimLine(rawLine);
+            if(trimmedLine.empty()) continue; //the line was just a comment
+            line.assign(trimmedLine.data(), trimmedLine.size());
+
+            switch(++lineNum)
+            {
+                case 1:
+                    data.description = line;
+                    break;
+                case 2:
+                    numNotesToRead = std::stoi(line);
+                    if(numNotesToRead < 0) return invalid(data, lineNum, "the number of notes is negative"); //there need to be at least 0 notes!!!
+                    break;
+                default:
+                {
+                    size_t divider;
+                    double noteRatio = std::stod(line, &divider);
+
+                    if(trimmedLine.substr(0, divider + 1).find('.') != std::string_view::npos) //if the value contains a decimal (need +1 so things like "200." will be included.
+                    { //then line in decimal/cents format
+                        noteRatio = intervals::centsToRatio(noteRatio);
+                    }
+                    else
+                    {
+                        std::string_view rest = utils::trimLine(trimmedLine.substr(divider)); //trimming off the first value, and any white space after it
+                        if(rest.size() > 0 && rest[0] == '/') //if the next char is a '/', we are in ratio format.
+                        {
+                            line.assign(rest.data() + 1, rest.size() - 1);
+                            noteRatio = noteRatio / static_cast<double>(std::stoi(line));
+                        }
+                    }
+                    if(noteRatio <= 0) return invalid(data, lineNum, "the note isn't positive"); //notes must be positive.
+                    data.notes.push_back(noteRatio);
+                }
+            }
+        }
+        if(static_cast<int>(data.notes.size()) != numNotesToRead) return invalid(data, lineNum, "the number of notes doesn't match the note count");
+        if(numNotesToRead == 0) data.notes.push_back(1.0);
+    }
+    catch (...) { return invalid(data, lineNum, "a number couldn't be read"); } // if formatted incorrectly, the data is invalid
+
+    data.isValid = true;
+    return data;
+}
+
+KbmData parseKbm(std::string_view kbmText, int scaleLength)
+{
+    KbmData data;
+    LineReader reader(kbmText);
+    std::string_view rawLine;
+    std::string line; // reused for every line, so it only allocates when a line is longer than any before it
+    int lineNum = 0; // counts the lines that aren't blank or comments
+    try
+    {
+        int mappingSize = 0;
+        while(reader.getNextLine(rawLine))
+        {
+            std::string_view trimmedLine = utils::trimLine(rawLine);
+            if(trimmedLine.empty()) continue; //the line was just a comment
+            line.assign(trimmedLine.data(), trimmedLine.size());
+
+            switch(++lineNum)
+            {
+                case 1: //the size of map. after how many keys the pattern repeats.
+                    mappingSize = std::stoi(line);
+                    if(mappingSize <= 0) return invalid(data, lineNum, "the map size isn't positive");
+                    break;
+                case 2: //first midi note number to retune
+                    data.retuneRangeLowerBound = std::stoi(line);
+                    break;
+                case 3: //last midi note number to retune
+                    data.retuneRangeUpperBound = std::stoi(line);
+                    break;
+                case 4: //middle note
+                    data.middleNote = std::stoi(line);
+                    if(data.middleNote < 0 || data.middleNote > 127) return invalid(data, lineNum, "the middle note isn't on [0, 127]");
+                    break;
+                case 5: //midi reference note
+                    data.referenceNote = std::stoi(line);
+                    break;
+                case 6: //frequency of reference midi note
+                    data.referenceFreq = std::stof(line);
+                    if(data.referenceFreq <= 0.0) return invalid(data, lineNum, "the reference frequency isn't positive");
+                    break;
+                case 7: //scale number to consider formal octave.
+                    //this value is 1-indexed in the file. We want it to be 0-indexed, so subtract 1.
+                    data.formalOctaveScaleDegree = std::stoi(line) - 1;
+                    if(data.formalOctaveScaleDegree < 0 || (scaleLength >= 0 && data.formalOctaveScaleDegree >= scaleLength)) return invalid(data, lineNum, "the formal octave isn't a note of the scale");
+                    break;
+                default:
+                    if(line.at(0) == 'x') //in this case, we are mapping 'x' to -1.
+                    {
+                        data.mapping.push_back(-1);
+                    }
+                    else
+                    {
+                        int mappingVal = std::stoi(line);
+                        if(mappingVal < 0) return invalid(data, lineNum, "the mapping is negative");
+                        data.mapping.push_back(mappingVal);
+                    }
+            }
+        }
+        if(lineNum < 7) return invalid(data, lineNum, "not all of the header values were found"); // not all meta values were read.
+        if(static_cast<int>(data.mapping.size()) > mappingSize) return invalid(data, lineNum, "there are more mappings than the map size"); //wrong mapping size
+        data.mapping.resize(static_cast<size_t>(mappingSize), -1); //fill rest of the mappings with -1
+    }
+    catch (...) { return invalid(data, lineNum, "a number couldn't be read"); } // if formatted incorrectly, the data is invalid
+
+    data.isValid = true;
+    return data;
+}
+
+bool readFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open()) return false;
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+}  // end namespace scala
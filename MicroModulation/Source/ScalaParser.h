@@ -0,0 +1,74 @@
+/*
+ ==============================================================================
+
+ ScalaParser.h
+
+ Parses the Scala '.scl' and '.kbm' file formats from memory.
+ The parse functions only read text and return a result object, so they never touch the file system,
+ an UndoManager, or a ValueTree. Scale and KeyboardMap load files by reading them into a string and parsing that,
+ and only change their state once a parse has succeeded.
+ See more here: http://www.huygens-fokker.org/scala/scl_format.html and http://www.huygens-fokker.org/scala/help.htm#mappings
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace scala {
+
+/**
+ The contents of a .scl file.
+ */
+struct SclData
+{
+    bool isValid = false;
+    std::string error; // why the text isn't valid, if it isn't
+    std::string description;
+    std::vector<double> notes; // the ratio of each note to the tonic. Cents are converted to ratios. A scale with 0 notes gets the single note 1/1.
+};
+
+/**
+ The contents of a .kbm file.
+ */
+struct KbmData
+{
+    bool isValid = false;
+    std::string error; // why the text isn't valid, if it isn't
+    int retuneRangeLowerBound = 0;
+    int retuneRangeUpperBound = 127;
+    int middleNote = 60;
+    int referenceNote = 69;
+    float referenceFreq = 440.0f;
+    int formalOctaveScaleDegree = -1; // 0-indexed (the file is 1-indexed)
+    std::vector<int> mapping;          // the scale degree of each key in the pattern, or -1 for unmapped keys ('x')
+};
+
+/**
+ Parses text formatted as a .scl file.
+ @param sclText The contents of a .scl file.
+ @return The parsed scale. If the text isn't a valid .scl file, isValid is false.
+ */
+SclData parseScl(std::string_view sclText);
+
+/**
+ Parses text formatted as a .kbm file.
+ @param kbmText The contents of a .kbm file.
+ @param scaleLength The number of notes in the scale the map will be used with, or -1 if it isn't known.
+ The formal octave has to be one of these notes.
+ @return The parsed keyboard map. If the text isn't a valid .kbm file, isValid is false.
+ */
+KbmData parseKbm(std::string_view kbmText, int scaleLength);
+
+/**
+ Reads a whole file into a string, so it can be parsed.
+ @param path The path to the file.
+ @param contents Set to the contents of the file.
+ @return false if the file couldn't be opened.
+ */
+bool readFile(const std::string& path, std::string& contents);
+
+}  // end namespace scala
@@ -1,229 +1,232 @@
-/*
- ==============================================================================
- 
- Scale.cpp
- Created: 22 May 2021 12:11:25pm
- Author:  Willow Weiner
- 
- ==============================================================================
- */
-
-#include <cstdio>
-#include <fstream>
-#include <math.h>
-#include <string>
-
-#include "JuceHeader.h"
-
-#include "Identifiers.h"
-#include "Scale.h"
-#include "utils.h"
-
-Scale::Scale(juce::UndoManager& um): scaleValues(IDs::scale), undoManager(um), kbm(um), hasScl(false)
-{
-    scaleValues.setProperty(IDs::scaleDescription, "", &undoManager);
-    scaleValues.setProperty(IDs::scaleNotes, juce::Array<juce::var>(), &undoManager);
-    scaleValues.setProperty(IDs::fundamentalFreq, juce::var(440.0f), &undoManager);
-    
-    scaleValues.addChild(kbm.keyboardMapValues, -1, &undoManager);
-    
-    initCalculatedFreqs();
-}
-Scale::Scale(juce::UndoManager& um, std::string sclPath): Scale(um) { loadSclFile(sclPath); }
-Scale::Scale(juce::UndoManager& um, std::string sclPath, std::string kbmPath): Scale(um, sclPath) { loadKbmFile(kbmPath); }
-
-bool Scale::loadSclFile(std::string sclPath)
-{
-    std::ifstream sclFile(sclPath);
-    std::string line;
-    if(sclFile.is_open())
-    {
-        undoManager.beginNewTransaction(); //if file read isn't sucessful, will reset to current state.
-        bool fileReadCorrectly = true;
-        getNotes().clear();
-
-        try{
-            int lineNum = 0;
-            int numNotesToRead = -1;
-            while(getline(sclFile, line))
-            {
-                //TODO: HACK maybe change implementation so we don't need an extra if block
-                if(lineNum == 0 && utils::removeWhiteSpace(line) == ""){//handles files with empty descriptions. hacky.
-                    scaleValues.setProperty(IDs::scaleDescription, juce::var(""), &undoManager);
-                    lineNum++;
-                }
-                
-                line = utils::removeLineSpaceAndComments(line);
-                if(line != "") //if our line wasn't just a comment line
-                {
-                    switch(++lineNum)
-                    {
-                        case 1:
-                            scaleValues.setProperty(IDs::scaleDescription, juce::var(line), &undoManager);
-                            break;
-                        case 2:
-                            numNotesToRead = std::stoi(line);
-                            if(numNotesToRead < 0) fileReadCorrectly = false; //there need to be at least 0 notes!!!
-                            break;
-                        default:
-                            size_t divider;
-                            float noteRatio = std::stof(line, &divider);
-                            
-                            if(line.substr(0,divider+1).find('.') != std::string::npos)//if the value contains a decimal (need +1 so things like "200." will be included.
-                            { //then line in decimal/cents format
-                                noteRatio = Scale::centsToRatio(noteRatio);
-                            }
-                            else {
-                                line = line.substr(divider); //trimming off the first value
-                                utils::removeLineSpaceAndComments(line);  //trimming off any additional white space
-                                if(line.size() > 0 && line.at(0) == '/') {//if the next char is a '/', we are in ratio format.
-                                    line = line.substr(1); //remove '/' charachter
-                                    noteRatio = noteRatio / (float)std::stoi(line);
-                                }
-                            }
-                            if(noteRatio <= 0) fileReadCorrectly = false;
-                            getNotes().add(noteRatio);
-                            //if(notes.back() <= 0) fileReadCorrectly = false; //notes must be positive.
-                    }
-                }
-                if(!fileReadCorrectly) break; // we don't need to keep reading if there is already an error!
-            }
-            sclFile.close();
-            
-            if(fileReadCorrectly && getNotes().size() != numNotesToRead) fileReadCorrectly = false;
-            if(fileReadCorrectly && numNotesToRead == 0){
-                getNotes().add(juce::var(1.0f));
-            }
-        }
-        catch (...) {fileReadCorrectly = false; } // if formatted incorrectly, return false
-        
-        if(fileReadCorrectly)
-        {
-            kbm.setToDefaultMapping(getNotes().size());
-            calcFundamentalFreq();
-            initCalculatedFreqs();
-            hasScl = true;
-            return true;
-        }
-        else // if the file isn't read correctly, return to previous state and return false
-        {
-            undoManager.undo();
-            return false;
-        }
-    }
-    else return false; // if file didn't open, return false;
-}
-
-
-bool Scale::loadSclFile(juce::File sclFile)
-{
-    return loadSclFile(sclFile.getFullPathName().toStdString());
-}
-bool Scale::loadSclString(std::string sclString)
-{
-    std::string tmpfilePath = utils::makeAndWriteTmpFile(sclString);
-    
-    bool output = loadSclFile(tmpfilePath);
-    remove(tmpfilePath.c_str());
-    return output;
-}
-
-//probably don't actually need these
-bool Scale::loadKbmFile(std::string kbmPath)
-{
-    bool output = kbm.loadKbmFile(kbmPath);
-    if(output)
-    {
-        initCalculatedFreqs(); //if .kbm changed, we need to recalculate frequencies.
-        calcFundamentalFreq();
-    }
-    return output;
-}
-bool Scale::loadKbmFile(juce::File kbmFile)
-{
-    return loadKbmFile(kbmFile.getFullPathName().toStdString());
-}
-bool Scale::loadKbmString(std::string kbmString)
-{
-    bool output = kbm.loadKbmString(kbmString);
-    if(output)
-    {
-        initCalculatedFreqs();
-        calcFundamentalFreq();
-    }
-    return output;
-}
-
-
-//TODO: test this
-/**
- Returns the frequency that should be played back.
- @param midiNoteNum the midiNote number.
- @return the frequncy that is associated with that midi note number.
- */
-float Scale::getFreq(juce::int8 midiNoteNum)
-{
-    assert(midiNoteNum >= 0);
-    float calculatedFreq = calculatedFreqs.getUnchecked(midiNoteNum);
-
-    if(freqHasBeenCalculated(midiNoteNum)) return calculatedFreq;
-    else{
-        calculatedFreq =  getNoteRatio(midiNoteNum - 1) //I don't know why we need the midiNoteNum - 1 in this function.
-        * pow( getNoteRatio(kbm.getFormalOctaveScaleDegree()), kbm.getOctave(midiNoteNum - 1))
-        * static_cast<float>(scaleValues.getProperty(IDs::fundamentalFreq));
-        
-        calculatedFreqs.set(midiNoteNum, calculatedFreq);
-        return calculatedFreq;
-    }
-}
-/**
- Modulates from center to pivot. The frequency-ratios around pivot after modulation will be the same as those around center before modulation.
- @param center
- @param pivot
- */
-void Scale::modulate(juce::int8 center, juce::int8 pivot)
-{
-    if(center != pivot) //if center == pivot, modulation does nothing. this can be made more general if optimization is nescicarry
-    {
-        undoManager.beginNewTransaction();
-        initCalculatedFreqs();
-
-        float prevFundamentalFreq = scaleValues.getProperty(IDs::fundamentalFreq);
-        scaleValues.setProperty(IDs::fundamentalFreq,
-                                prevFundamentalFreq * getNoteRatio(pivot) / getNoteRatio(center)
-                                , &undoManager);
-        
-        
-//        int prevMiddleNote = kbm.keyboardMapValues.getProperty(IDs::middleNote);
-//        kbm.keyboardMapValues.setProperty(IDs::middleNote, prevMiddleNote - kbm.getMappingIndex(center) + kbm.getMappingIndex(pivot), &undoManager);
-    }
-}
-
-
-
-/**
- Calculates the 'fundamental' or reference frequency for the scale. This corresponds to the frequency that this->kbm.getMiddleNote() is mapped to.
- */
-void Scale::calcFundamentalFreq()
-{
-    scaleValues.setProperty(IDs::fundamentalFreq,
-                            kbm.getReferenceFreq() / (float) getNoteRatio(kbm.getReferenceMidiNote()) //freq of first note in Notes at refernce octave
-                            * (float) getNoteRatio(kbm.getMiddleNote())
-                            * pow( (float) getNoteRatio(kbm.getFormalOctaveScaleDegree()), -kbm.getOctave(kbm.getReferenceMidiNote())), //octave multiplier to get to the middle note from the reference note
-                            &undoManager);
-}
-
-
-
-void Scale::initCalculatedFreqs()
-{
-    calculatedFreqs.clearQuick();
-    calculatedFreqs.resize(128); //128, because there are 128 midi values
-    calculatedFreqs.fill(-1.0f);
-}
-
-bool Scale::freqHasBeenCalculated(juce::int8 midiNoteNum)
-{
-    assert(midiNoteNum >= 0);
-    return calculatedFreqs.getUnchecked(midiNoteNum) != -1.0;
-}
+/*
+ ==============================================================================
+ 
+ Scale.cpp
+ Created: 22 May 2021 12:11:25pm
+ Author:  Willow Weiner
+ 
+ ==============================================================================
+ */
+
+#include <limits>
+#include <math.h>
+#include <string>
+
+#include "JuceHeader.h"
+
+#include "Identifiers.h"
+#include "Scale.h"
+#include "utils.h"
+
+Scale::Scale(juce::UndoManager& um): scaleValues(IDs::scale), undoManager(um), kbm(um), fundamentalPitch(69.0), modulationOffset(0.0), modulationRatio(1.0), hasScl(false), isCompileDeferred(false)
+{
+    scaleValues.setProperty(IDs::scaleDescription, "", &undoManager);
+    scaleValues.setProperty(IDs::scaleNotes, juce::Array<juce::var>(), &undoManager);
+    scaleValues.setProperty(IDs::fundamentalPitch, fundamentalPitch, &undoManager);
+    scaleValues.setProperty(IDs::modulationOffset, modulationOffset, &undoManager);
+    
+    scaleValues.addChild(kbm.keyboardMapValues, -1, &undoManager);
+    
+    compileTuning({});
+    scaleValues.addListener(this);
+}
+Scale::Scale(juce::UndoManager& um, std::string sclPath): Scale(um) { loadSclFile(sclPath); }
+Scale::Scale(juce::UndoManager& um, std::string sclPath, std::string kbmPath): Scale(um, sclPath) { loadKbmFile(kbmPath); }
+
+bool Scale::loadSclFile(std::string sclPath)
+{
+    std::string sclText;
+    if(!scala::readFile(sclPath, sclText)) return false; // if file didn't open, return false;
+    return loadSclString(sclText);
+}
+bool Scale::loadSclFile(juce::File sclFile)
+{
+    return loadSclFile(sclFile.getFullPathName().toStdString());
+}
+bool Scale::loadSclString(std::string_view sclString)
+{
+    return loadScl(*TuningCache::parseScl(sclString));
+}
+bool Scale::loadScl(const scala::SclData& scl)
+{
+    if(!scl.isValid) return false; // nothing has been changed yet, so there is nothing to undo.
+    
+    const juce::ScopedValueSetter<bool> deferCompile(isCompileDeferred, true);
+    undoManager.beginNewTransaction();
+    std::vector<double> noteSemitones;
+    for(double note : scl.notes) noteSemitones.push_back(ratioToSemitones(note));
+    scaleValues.setProperty(IDs::scaleDescription, juce::var(juce::String(scl.description)), &undoManager);
+    
+    kbm.setToDefaultMapping(static_cast<int>(scl.notes.size()));
+    calcFundamentalPitch(noteSemitones); //the tuning still has the old notes, since it is only compiled below
+    hasScl = true;
+    compileTuning(scl.notes);
+    scaleValues.setProperty(IDs::scaleNotes, tuning->getNotesValue(), &undoManager); //shared with every Scale that has this tuning
+    return true;
+}
+
+//probably don't actually need these
+bool Scale::loadKbmFile(std::string kbmPath)
+{
+    std::string kbmText;
+    if(!scala::readFile(kbmPath, kbmText)) return false; // if file didn't open, return false;
+    return loadKbmString(kbmText);
+}
+bool Scale::loadKbmFile(juce::File kbmFile)
+{
+    return loadKbmFile(kbmFile.getFullPathName().toStdString());
+}
+bool Scale::loadKbmString(std::string_view kbmString)
+{
+    return loadKbm(*TuningCache::parseKbm(kbmString, kbm.keyboardMapValues.getProperty(IDs::scaleLength)));
+}
+bool Scale::loadFromScalePack(const ScalePack& pack, int index)
+{
+    if(index < 0 || index >= pack.getNumEntries()) return false;
+    if(pack.getEntry(index).type == ScalePack::EntryType::scl) return loadScl(pack.getScl(index));
+    return loadKbm(pack.getKbm(index));
+}
+bool Scale::loadKbm(const scala::KbmData& kbmData)
+{
+    const juce::ScopedValueSetter<bool> deferCompile(isCompileDeferred, true);
+    if(!kbm.loadKbm(kbmData)) return false;
+    calcFundamentalPitch(getNoteSemitones()); //the notes haven't changed, so the old tuning's semitones are still right
+    compileTuning(getNoteRatios());
+    return true;
+}
+
+bool Scale::undo()
+{
+    const juce::ScopedValueSetter<bool> deferCompile(isCompileDeferred, true);
+    if(!undoManager.undo()) return false;
+    setModulationOffset(0.0); //the modulation isn't recorded, so the restored tuning starts unmodulated like a load
+    compileTuning(readNoteRatios());
+    return true;
+}
+
+bool Scale::redo()
+{
+    const juce::ScopedValueSetter<bool> deferCompile(isCompileDeferred, true);
+    if(!undoManager.redo()) return false;
+    setModulationOffset(0.0);
+    compileTuning(readNoteRatios());
+    return true;
+}
+
+
+//TODO: test this
+/**
+ Returns the frequency that should be played back.
+ @param midiNoteNum the midiNote number.
+ @return the frequncy that is associated with that midi note number.
+ */
+float Scale::getFreq(juce::int8 midiNoteNum)
+{
+    assert(midiNoteNum >= 0);
+    float freq = tuning->getFreq(midiNoteNum);
+    return freq < 0.0f ? freq : static_cast<float>(freq * modulationRatio);
+}
+
+double Scale::getUnmodulatedPitch(juce::int8 midiNoteNum)
+{
+    assert(midiNoteNum >= 0);
+    return tuning->getPitch(midiNoteNum);
+}
+
+double Scale::getNoteSemitones(int midiNoteNum, bool isScaleDegree)
+{
+    return getNoteSemitones(getNoteSemitones(), midiNoteNum, isScaleDegree);
+}
+
+double Scale::getNoteSemitones(const std::vector<double>& noteSemitones, int midiNoteNum, bool isScaleDegree)
+{
+    int scaleDegree = isScaleDegree ? midiNoteNum : kbm.getScaleDegree(static_cast<juce::int8>(midiNoteNum));
+    if(scaleDegree >= static_cast<int>(noteSemitones.size()) || scaleDegree < 0) return std::numeric_limits<double>::quiet_NaN();
+    return noteSemitones[static_cast<size_t>(scaleDegree)];
+}
+/**
+ Modulates from center to pivot. The frequency-ratios around pivot after modulation will be the same as those around center before modulation.
+ @param center
+ @param pivot
+ */
+void Scale::modulate(juce::int8 center, juce::int8 pivot)
+{
+    if(center != pivot) //if center == pivot, modulation does nothing. this can be made more general if optimization is nescicarry
+    {
+        double interval = getModulationInterval(center, pivot);
+        if(std::isnan(interval)) return; //one of the notes isn't mapped, so there is nothing to modulate to
+
+        //in the log domain, a modulation is one addition. it isn't added to the undo history, see ModulationHistory
+        scaleValues.setProperty(IDs::modulationOffset, modulationOffset + interval, nullptr);
+        
+        
+//        int prevMiddleNote = kbm.keyboardMapValues.getProperty(IDs::middleNote);
+//        kbm.keyboardMapValues.setProperty(IDs::middleNote, prevMiddleNote - kbm.getMappingIndex(center) + kbm.getMappingIndex(pivot), &undoManager);
+    }
+}
+
+
+
+double Scale::getModulationInterval(juce::int8 center, juce::int8 pivot)
+{
+    if(getNumNotes() == 0 || kbm.getMappingSize() == 0) return std::numeric_limits<double>::quiet_NaN();
+    return getNoteSemitones(pivot) - getNoteSemitones(center);
+}
+
+void Scale::setModulationOffset(double semitones)
+{
+    if(semitones == modulationOffset) return;
+    scaleValues.setProperty(IDs::modulationOffset, semitones, nullptr);
+}
+
+void Scale::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property)
+{
+    if(tree == scaleValues && property == IDs::modulationOffset) //the tables don't include the modulation, so they don't need to be compiled again
+    {
+        modulationOffset = scaleValues.getProperty(IDs::modulationOffset);
+        modulationRatio = std::exp2(modulationOffset / 12.0);
+        return;
+    }
+    if(tree == scaleValues && property == IDs::fundamentalPitch) fundamentalPitch = scaleValues.getProperty(IDs::fundamentalPitch);
+    if(property == IDs::keyboardMapping) kbm.syncScaleDegrees(); //in case this listener was called before kbm's
+    if(isCompileDeferred) return; //a load (or undo) sets several properties, and compiles once they are all set
+    if(tree == scaleValues && property == IDs::scaleNotes)
+    {
+        compileTuning(readNoteRatios());
+        return;
+    }
+    compileTuning(getNoteRatios());
+}
+
+std::vector<double> Scale::readNoteRatios()
+{
+    const juce::Array<juce::var>& notes = getNotes();
+    std::vector<double> noteRatios(static_cast<size_t>(notes.size()));
+    for(int i = 0; i < notes.size(); i++) noteRatios[static_cast<size_t>(i)] = notes.getUnchecked(i);
+    return noteRatios;
+}
+
+/**
+ Calculates the 'fundamental' or reference pitch for the scale. This corresponds to the pitch that this->kbm.getMiddleNote() is mapped to.
+ This is the only place a frequency is converted to a pitch, so it is the only log2 when loading a tuning.
+ */
+void Scale::calcFundamentalPitch(const std::vector<double>& noteSemitones)
+{
+    double pitch = utils::freqToMidi(kbm.getReferenceFreq(), 440.0)
+                   - getNoteSemitones(noteSemitones, kbm.getReferenceMidiNote(), false) //pitch of first note in Notes at refernce octave
+                   + getNoteSemitones(noteSemitones, kbm.getMiddleNote(), false)
+                   - kbm.getOctave(kbm.getReferenceMidiNote()) * getNoteSemitones(noteSemitones, kbm.getFormalOctaveScaleDegree(), true); //octaves to get to the middle note from the reference note
+    scaleValues.setProperty(IDs::modulationOffset, 0.0, nullptr); //a new tuning starts unmodulated. Like modulate(), this isn't recorded
+    if(std::isnan(pitch)) return; //the reference or middle note isn't mapped, so there is no way to tell the pitch
+    scaleValues.setProperty(IDs::fundamentalPitch, pitch, &undoManager);
+}
+
+
+
+void Scale::compileTuning(const std::vector<double>& noteRatios)
+{
+    //getNoteRatios() may be passed in, so tuning is only released once the new one has been found
+    CompiledTuning::Ptr newTuning = TuningCache::getTuning(noteRatios, kbm.getScaleDegrees(), kbm.getMiddleNote(),
+                                                          kbm.getFormalOctaveScaleDegree(), fundamentalPitch);
+    tuning = newTuning;
+}
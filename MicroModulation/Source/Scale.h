@@ -1,116 +1,233 @@
-/*
- ==============================================================================
-
- Scale.h
- 
-   
- This class acts as a wrapper for the Scala '.scl' file type.
- It allows users to use custom scales with intervals based on ratios or specified in cents of a semitone.
- This class also translates MIDI note numbers into frequency information, with help from the KeyboardMap class.
-    
- 
- Created: 21 May 2021 10:03:02pm
- Author:  Willow Weiner
- 
- =============================================================================
- */
-
-#pragma once
-
-#include <cmath>
-#include <string>
-
-#include "JuceHeader.h"
-
-#include "Identifiers.h"
-#include "KeyboardMap.h"
-
-//TODO: Add complete documentation
-class Scale
-{
-public:
-    Scale(juce::UndoManager& um);
-    Scale(juce::UndoManager& um, std::string sclPath);
-    Scale(juce::UndoManager& um, std::string sclPath, std::string kbmPath);
-    
-    juce::ValueTree scaleValues;
-    // ==============================================================================
-    // Static Stuff
-    // ==============================================================================
-    //TODO: move this to utils.h, maybe? It may be able to just be a private function, as well.
-    //It is something that may be helpful to have, which is why I have put it here.
-    static float centsToRatio(float cents){
-        return std::pow(M_E, (cents * std::log(2.0) / 1200.0) );
-    }
-    
-    // ==============================================================================
-    // Getters and Setters
-    // ==============================================================================
-
-    juce::Array<juce::var>& getNotes(){
-//        jassert(scaleValues.hasProperty(IDs::scaleNotes));
-//        jassert(scaleValues.getProperty(IDs::scaleNotes).isArray());
-        return *(scaleValues.getProperty(IDs::scaleNotes).getArray());
-    }
-    float getNoteRatio(int midiNoteNum) {
-        return getNoteRatioOfScaleDegree(kbm.getScaleDegree(midiNoteNum));
-    }
-    float getNoteRatioOfScaleDegree(int scaleDegree) {
-        if(scaleDegree >= getNotes().size() || scaleDegree < 0) return -1;
-        return getNotes().getUnchecked(scaleDegree);
-    }
-    void setNotes(juce::Array<juce::var> newNotes) {
-        jassert(scaleValues.hasProperty(IDs::scaleNotes));
-        scaleValues.getPropertyAsValue(IDs::scaleNotes, &undoManager).setValue(juce::var(newNotes));
-    }
-    
-    
-    std::string getDescription(){ return scaleValues.getProperty(IDs::scaleDescription).toString().toStdString();}
-
-    KeyboardMap getKeyboardMap(){return this->kbm;}
-    //void setKeyboardMap(KeyboardMap kb){this->kbm = kb;}
-
-    // ==============================================================================
-    // File loading
-    // ==============================================================================
-    bool loadSclFile(std::string sclPath);
-    bool loadSclFile(juce::File sclFile);
-    /**
-     Loads a scale based on a .scl file stored in a string.
-     @param sclString a string that is formatted like a .scl file. to be loaded
-     */
-    bool loadSclString(std::string sclString);
-
-    bool loadKbmFile(std::string kbmPath);
-    bool loadKbmFile(juce::File kbmFile);
-    bool loadKbmString(std::string kbmString);
-
-    bool hasSclLoaded(){return hasScl;}
-    
-    /**
-     Returns the frequency that should be played back.
-     @param midiNoteNum the midiNote number.
-     @return the frequncy that is associated with that midi note number.
-     */
-    float getFreq(juce::int8 midiNoteNum);
-
-    
-    /**
-     Modulates from center to pivot. The frequency-ratios around pivot after modulation will be the same as those around center before modulation.
-     @param center midino
-     @param pivot
-     */
-    void modulate(juce::int8 center, juce::int8 pivot);
-    
-private:
-    
-    juce::UndoManager& undoManager;
-    KeyboardMap kbm;
-    void calcFundamentalFreq();
-    bool hasScl; //TODO: conver this to a scaleValues property
-    
-    juce::Array<float> calculatedFreqs; //stores frequencyies that have already been calculated so that getFreq() is more efficient.
-    void initCalculatedFreqs();
-    bool freqHasBeenCalculated(juce::int8 midiNoteNum);
-
-};
+/*
+ ==============================================================================
+
+ Scale.h
+ 
+   
+ This class acts as a wrapper for the Scala '.scl' file type.
+ It allows users to use custom scales with intervals based on ratios or specified in cents of a semitone.
+ This class also translates MIDI note numbers into frequency information, with help from the KeyboardMap class.
+    
+ 
+ Created: 21 May 2021 10:03:02pm
+ Author:  Willow Weiner
+ 
+ =============================================================================
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "Identifiers.h"
+#include "Intervals.h"
+#include "KeyboardMap.h"
+#include "ScalaParser.h"
+#include "ScalePack.h"
+#include "TuningCache.h"
+
+//TODO: Add complete documentation
+class Scale : public juce::ValueTree::Listener
+{
+public:
+    Scale(juce::UndoManager& um);
+    Scale(juce::UndoManager& um, std::string sclPath);
+    Scale(juce::UndoManager& um, std::string sclPath, std::string kbmPath);
+    
+    juce::ValueTree scaleValues;
+    // ==============================================================================
+    // Static Stuff
+    // ==============================================================================
+    //TODO: move this to utils.h, maybe? It may be able to just be a private function, as well.
+    //It is something that may be helpful to have, which is why I have put it here.
+    static float centsToRatio(float cents){ return static_cast<float>(intervals::centsToRatio(cents)); }
+    static double centsToRatio(double cents){ return intervals::centsToRatio(cents); }
+    static double ratioToSemitones(double ratio){ return intervals::ratioToSemitones(ratio); }
+    static double midiPitchToFreq(double midiPitch){ return 440.0 * std::exp2((midiPitch - 69.0) / 12.0); }
+    
+    // ==============================================================================
+    // Getters and Setters
+    // ==============================================================================
+
+    /**
+     @return The notes as they are stored in scaleValues, for saving and undo.
+     After a load, the array is shared with every Scale that has the same tuning, so use setNotes() to change the notes.
+     */
+    const juce::Array<juce::var>& getNotes() const {
+//        jassert(scaleValues.hasProperty(IDs::scaleNotes));
+//        jassert(scaleValues.getProperty(IDs::scaleNotes).isArray());
+        return *(scaleValues.getProperty(IDs::scaleNotes).getArray());
+    }
+    /**
+     @return The ratio of each note to the tonic. Kept in sync with the scaleNotes property, so reading it never touches the ValueTree.
+     */
+    const std::vector<double>& getNoteRatios() const { return tuning->getNoteRatios(); }
+    int getNumNotes() const { return static_cast<int>(tuning->getNoteRatios().size()); }
+    /**
+     @return The size of each note above the tonic, in semitones. Kept in sync with getNoteRatios().
+     */
+    const std::vector<double>& getNoteSemitones() const { return tuning->getNoteSemitones(); }
+    /**
+     @param midiNoteNum A midi note number, or a scale degree if isScaleDegree is true.
+     @return The semitones of the scale degree that midiNoteNum is mapped to (not counting its octave), or NaN if it isn't mapped.
+     */
+    double getNoteSemitones(int midiNoteNum, bool isScaleDegree = false);
+    double getNoteRatio(int midiNoteNum) {
+        return getNoteRatioOfScaleDegree(kbm.getScaleDegree(midiNoteNum));
+    }
+    double getNoteRatioOfScaleDegree(int scaleDegree) {
+        if(scaleDegree >= getNumNotes() || scaleDegree < 0) return -1;
+        return getNoteRatios()[static_cast<size_t>(scaleDegree)];
+    }
+    void setNotes(juce::Array<juce::var> newNotes) {
+        jassert(scaleValues.hasProperty(IDs::scaleNotes));
+        scaleValues.getPropertyAsValue(IDs::scaleNotes, &undoManager).setValue(juce::var(newNotes));
+    }
+    
+    
+    std::string getDescription(){ return scaleValues.getProperty(IDs::scaleDescription).toString().toStdString();}
+
+    KeyboardMap& getKeyboardMap(){return this->kbm;}
+    //void setKeyboardMap(KeyboardMap kb){this->kbm = kb;}
+
+    // ==============================================================================
+    // File loading
+    // ==============================================================================
+    bool loadSclFile(std::string sclPath);
+    bool loadSclFile(juce::File sclFile);
+    /**
+     Loads a scale based on a .scl file stored in a string. Nothing is written to disk.
+     @param sclString a string that is formatted like a .scl file. to be loaded
+     */
+    bool loadSclString(std::string_view sclString);
+    /**
+     Loads a scale that has already been parsed. If scl isn't valid, nothing changes.
+     @return scl.isValid
+     */
+    bool loadScl(const scala::SclData& scl);
+
+    bool loadKbmFile(std::string kbmPath);
+    bool loadKbmFile(juce::File kbmFile);
+    bool loadKbmString(std::string_view kbmString);
+    /**
+     Loads a keyboard map that has already been parsed. If kbm isn't valid (or doesn't fit the scale), nothing changes.
+     @return true if the map was loaded.
+     */
+    bool loadKbm(const scala::KbmData& kbmData);
+
+    /**
+     Loads an entry of a ScalePack, without reading or parsing any text. A .scl entry replaces the scale,
+     and a .kbm entry replaces the keyboard map.
+     @param pack The pack to load from.
+     @param index The index of the entry in pack.
+     @return false if the entry couldn't be loaded (ex: a .kbm whose formal octave isn't in the scale).
+     */
+    bool loadFromScalePack(const ScalePack& pack, int index);
+
+    /**
+     Undoes the last load (or edit) recorded in the UndoManager, and compiles the tuning once it is restored.
+     Modulations aren't recorded, so the restored tuning starts unmodulated.
+     Calling undo() on the UndoManager directly works too, but compiles the tuning for every property it restores.
+     @return false if there was nothing to undo.
+     */
+    bool undo();
+    /**
+     Redoes the last undone load (or edit), and compiles the tuning once. See undo().
+     @return false if there was nothing to redo.
+     */
+    bool redo();
+
+    bool hasSclLoaded(){return hasScl;}
+    
+    /**
+     Returns the frequency that should be played back. This only reads a table, which is compiled whenever the tuning changes,
+     and scales it by the modulation.
+     @param midiNoteNum the midiNote number.
+     @return the frequncy that is associated with that midi note number, or -1 if the note isn't mapped.
+     */
+    float getFreq(juce::int8 midiNoteNum);
+    /**
+     Returns the pitch that should be played back, as a fractional midi note number (69.0 is A440).
+     This only reads a table, which is compiled whenever the tuning changes, and adds the modulation offset.
+     @param midiNoteNum the midiNote number.
+     @return the pitch of that midi note number, or NaN if the note isn't mapped.
+     */
+    double getPitch(juce::int8 midiNoteNum) { return getUnmodulatedPitch(midiNoteNum) + modulationOffset; }
+    /**
+     @return The pitch of midiNoteNum before any modulations, or NaN if the note isn't mapped.
+     */
+    double getUnmodulatedPitch(juce::int8 midiNoteNum);
+    /**
+     @return The pitch of the middle note's octave, that every other pitch is relative to. See getPitch().
+     */
+    double getFundamentalPitch() const { return fundamentalPitch; }
+    /**
+     @return The semitones that modulations have added to every pitch since the tuning was loaded.
+     */
+    double getModulationOffset() const { return modulationOffset; }
+
+    
+    /**
+     Modulates from center to pivot. The frequency-ratios around pivot after modulation will be the same as those around center before modulation.
+     A modulation only changes the modulation offset, so it takes the same (constant) time for any size of scale.
+     @param center midino
+     @param pivot
+     */
+    void modulate(juce::int8 center, juce::int8 pivot);
+    /**
+     @return The semitones that modulate(center, pivot) would add to every pitch, or NaN if either note isn't mapped.
+     */
+    double getModulationInterval(juce::int8 center, juce::int8 pivot);
+    /**
+     Sets the modulation offset directly. Like modulate(), this isn't added to the undo history (MidiProcessor keeps a ModulationHistory).
+     @param semitones The new offset from the unmodulated tuning.
+     */
+    void setModulationOffset(double semitones);
+    
+    /**
+     @return The compiled tables of the unmodulated tuning. Shared with every other Scale in the process that has the same tuning.
+     */
+    const CompiledTuning& getCompiledTuning() const { return *tuning; }
+    
+    /**
+     Compiles the tuning again (or finds it in TuningCache) whenever scaleValues (or keyboardMapValues) changes.
+     Loads and undo() compile once after setting all of their properties instead.
+     The scaleNotes property is only converted to ratios when it changes.
+     */
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property) override;
+    
+private:
+    
+    juce::UndoManager& undoManager;
+    KeyboardMap kbm;
+    CompiledTuning::Ptr tuning; // the notes, mapping, and tables, shared through TuningCache. Never null
+    double fundamentalPitch; // a copy of the fundamentalPitch property
+    double modulationOffset; // a copy of the modulationOffset property
+    double modulationRatio;  // modulationOffset as a frequency ratio
+    /**
+     Sets the fundamentalPitch property from the keyboard map and noteSemitones (which may not be compiled yet),
+     and resets the modulation.
+     */
+    void calcFundamentalPitch(const std::vector<double>& noteSemitones);
+    bool hasScl; //TODO: conver this to a scaleValues property
+    bool isCompileDeferred; // true while a load or undo sets properties, so that the tuning is only compiled at the end
+
+    double getNoteSemitones(const std::vector<double>& noteSemitones, int midiNoteNum, bool isScaleDegree);
+    /**
+     @return The scaleNotes property as ratios.
+     */
+    std::vector<double> readNoteRatios();
+    
+    /**
+     Replaces tuning with the one compiled from noteRatios, the keyboard map, and the fundamental pitch.
+     Called whenever any of them change. The tables are only compiled if no other Scale has the same tuning.
+     */
+    void compileTuning(const std::vector<double>& noteRatios);
+
+};
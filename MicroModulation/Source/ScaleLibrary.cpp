@@ -0,0 +1,269 @@
+/*
+ ==============================================================================
+
+ ScaleLibrary.cpp
+
+ ==============================================================================
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+
+#include "Identifiers.h"  //stores all juce::Identifier s in namespace "IDs"
+#include "ScalaParser.h"
+#include "ScaleLibrary.h"
+
+ScaleLibrary::ScaleLibrary() : threadPool(juce::jmax(1, juce::SystemStats::getNumCpus())) {}
+
+int ScaleLibrary::scan(const juce::File& directory)
+{
+    juce::Array<juce::File> files = directory.findChildFiles(juce::File::findFiles, true, "*.scl;*.kbm");
+
+    std::vector<Entry> scanned;
+    scanned.reserve(entries.size() + static_cast<size_t>(files.size()));
+    for(const Entry& entry : entries) //keep the entries of other directories
+    {
+        if(!juce::File(entry.path).isAChildOf(directory)) scanned.push_back(entry);
+    }
+
+    std::vector<juce::File> changedFiles;
+    for(const juce::File& file : files)
+    {
+        const Entry* existing = getEntry(file.getFullPathName().toStdString());
+        if(existing != nullptr && existing->modificationTime == file.getLastModificationTime().toMilliseconds())
+        {
+            scanned.push_back(*existing);
+        }
+        else
+        {
+            changedFiles.push_back(file);
+        }
+    }
+
+    //parse the changed files in parallel. Each job writes to its own entry, so they don't need to lock.
+    size_t firstChanged = scanned.size();
+    scanned.resize(firstChanged + changedFiles.size());
+    std::atomic<size_t> numRemaining(changedFiles.size());
+    juce::WaitableEvent finished;
+    for(size_t i = 0; i < changedFiles.size(); i++)
+    {
+        threadPool.addJob([&, i]
+        {
+            scanned[firstChanged + i] = makeEntry(changedFiles[i]);
+            if(--numRemaining == 0) finished.signal();
+        });
+    }
+    if(!changedFiles.empty()) finished.wait();
+
+    std::sort(scanned.begin(), scanned.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    entries = std::move(scanned);
+    rebuildIndexes();
+    return static_cast<int>(changedFiles.size());
+}
+
+ScaleLibrary::Entry ScaleLibrary::makeEntry(const juce::File& file)
+{
+    Entry entry;
+    entry.path = file.getFullPathName().toStdString();
+    entry.isKbm = file.hasFileExtension("kbm");
+    entry.modificationTime = file.getLastModificationTime().toMilliseconds();
+
+    std::string contents;
+    if(!scala::readFile(entry.path, contents))
+    {
+        entry.error = "the file couldn't be read";
+        return entry;
+    }
+
+    if(entry.isKbm)
+    {
+        scala::KbmData kbm = scala::parseKbm(contents, -1);
+        entry.isValid = kbm.isValid;
+        entry.error = kbm.error;
+        entry.numNotes = static_cast<int>(kbm.mapping.size());
+    }
+    else
+    {
+        scala::SclData scl = scala::parseScl(contents);
+        entry.isValid = scl.isValid;
+        entry.error = scl.error;
+        entry.description = scl.description;
+        if(scl.isValid)
+        {
+            entry.numNotes = static_cast<int>(scl.notes.size());
+            entry.periodCents = 1200.0 * std::log2(scl.notes.back());
+            entry.fingerprint = makeFingerprint(scl.notes);
+        }
+    }
+    entry.tokens = tokenize(entry.description + " " + file.getFileNameWithoutExtension().toStdString());
+    return entry;
+}
+
+std::vector<std::string> ScaleLibrary::tokenize(std::string_view text)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+    for(size_t i = 0; i <= text.size(); i++)
+    {
+        unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+        if(std::isalnum(c))
+        {
+            token += static_cast<char>(std::tolower(c));
+        }
+        else if(!token.empty())
+        {
+            if(std::find(tokens.begin(), tokens.end(), token) == tokens.end()) tokens.push_back(token);
+            token.clear();
+        }
+    }
+    return tokens;
+}
+
+juce::uint64 ScaleLibrary::makeFingerprint(const std::vector<double>& notes)
+{
+    juce::uint64 hash = 14695981039346656037ull; //FNV-1a
+    for(double note : notes)
+    {
+        auto tenthsOfCents = static_cast<juce::int64>(std::llround(12000.0 * std::log2(note)));
+        for(int byte = 0; byte < 8; byte++)
+        {
+            hash ^= static_cast<juce::uint64>(tenthsOfCents >> (8 * byte)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+void ScaleLibrary::rebuildIndexes()
+{
+    pathIndex.clear();
+    numNotesIndex.clear();
+    periodIndex.clear();
+    tokenIndex.clear();
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        const Entry& entry = entries[i];
+        pathIndex[entry.path] = i;
+        numNotesIndex[entry.numNotes].push_back(i);
+        if(entry.periodCents >= 0.0) periodIndex.emplace_back(entry.periodCents, i);
+        for(const std::string& token : entry.tokens) tokenIndex[token].push_back(i);
+    }
+    std::sort(periodIndex.begin(), periodIndex.end());
+}
+
+std::vector<const ScaleLibrary::Entry*> ScaleLibrary::find(const Query& query) const
+{
+    std::vector<std::string> words = tokenize(query.text);
+
+    //start from the smallest list of candidates an index can give, then check the rest of the query on each
+    std::vector<size_t> candidates;
+    if(!words.empty())
+    {
+        for(auto it = tokenIndex.lower_bound(words[0]); it != tokenIndex.end() && it->first.compare(0, words[0].size(), words[0]) == 0; ++it)
+        {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+    else if(query.numNotes >= 0)
+    {
+        auto it = numNotesIndex.find(query.numNotes);
+        if(it != numNotesIndex.end()) candidates = it->second;
+    }
+    else if(query.periodCents >= 0.0)
+    {
+        auto first = std::lower_bound(periodIndex.begin(), periodIndex.end(), std::make_pair(query.periodCents - query.periodToleranceCents, size_t(0)));
+        for(auto it = first; it != periodIndex.end() && it->first <= query.periodCents + query.periodToleranceCents; ++it)
+        {
+            candidates.push_back(it->second);
+        }
+        std::sort(candidates.begin(), candidates.end());
+    }
+    else
+    {
+        candidates.resize(entries.size());
+        for(size_t i = 0; i < entries.size(); i++) candidates[i] = i;
+    }
+
+    std::vector<const Entry*> results;
+    for(size_t i : candidates)
+    {
+        if(matches(entries[i], query, words)) results.push_back(&entries[i]);
+    }
+    return results;
+}
+
+bool ScaleLibrary::matches(const Entry& entry, const Query& query, const std::vector<std::string>& words) const
+{
+    if(entry.isKbm != query.isKbm) return false;
+    if(!entry.isValid && !query.includeInvalid) return false;
+    if(query.numNotes >= 0 && entry.numNotes != query.numNotes) return false;
+    if(query.periodCents >= 0.0 && std::abs(entry.periodCents - query.periodCents) > query.periodToleranceCents) return false;
+    for(const std::string& word : words)
+    {
+        bool found = std::any_of(entry.tokens.begin(), entry.tokens.end(),
+                                 [&](const std::string& token) { return token.compare(0, word.size(), word) == 0; });
+        if(!found) return false;
+    }
+    return true;
+}
+
+const ScaleLibrary::Entry* ScaleLibrary::getEntry(const std::string& path) const
+{
+    auto it = pathIndex.find(path);
+    return it == pathIndex.end() ? nullptr : &entries[it->second];
+}
+
+bool ScaleLibrary::saveIndex(const juce::File& indexFile) const
+{
+    juce::ValueTree index(IDs::scaleLibrary);
+    for(const Entry& entry : entries)
+    {
+        juce::ValueTree child(IDs::libraryEntry);
+        child.setProperty(IDs::path, juce::String(entry.path), nullptr);
+        child.setProperty(IDs::isKbm, entry.isKbm, nullptr);
+        child.setProperty(IDs::modificationTime, entry.modificationTime, nullptr);
+        child.setProperty(IDs::isValid, entry.isValid, nullptr);
+        child.setProperty(IDs::parseError, juce::String(entry.error), nullptr);
+        child.setProperty(IDs::scaleDescription, juce::String(entry.description), nullptr);
+        child.setProperty(IDs::numNotes, entry.numNotes, nullptr);
+        child.setProperty(IDs::periodCents, entry.periodCents, nullptr);
+        child.setProperty(IDs::fingerprint, juce::String::toHexString(static_cast<juce::int64>(entry.fingerprint)), nullptr); //var has no unsigned 64 bit type
+        index.appendChild(child, nullptr);
+    }
+    std::unique_ptr<juce::XmlElement> xml = index.createXml();
+    return xml != nullptr && xml->writeTo(indexFile);
+}
+
+bool ScaleLibrary::loadIndex(const juce::File& indexFile)
+{
+    std::unique_ptr<juce::XmlElement> xml = juce::parseXML(indexFile);
+    if(xml == nullptr) return false;
+    juce::ValueTree index = juce::ValueTree::fromXml(*xml);
+    if(!index.hasType(IDs::scaleLibrary)) return false;
+
+    std::vector<Entry> loaded;
+    loaded.reserve(static_cast<size_t>(index.getNumChildren()));
+    for(const juce::ValueTree& child : index)
+    {
+        Entry entry;
+        entry.path = child[IDs::path].toString().toStdString();
+        entry.isKbm = child[IDs::isKbm];
+        entry.modificationTime = child[IDs::modificationTime];
+        entry.isValid = child[IDs::isValid];
+        entry.error = child[IDs::parseError].toString().toStdString();
+        entry.description = child[IDs::scaleDescription].toString().toStdString();
+        entry.numNotes = child[IDs::numNotes];
+        entry.periodCents = child[IDs::periodCents];
+        entry.fingerprint = static_cast<juce::uint64>(child[IDs::fingerprint].toString().getHexValue64());
+        entry.tokens = tokenize(entry.description + " " + juce::File(entry.path).getFileNameWithoutExtension().toStdString());
+        loaded.push_back(std::move(entry));
+    }
+    std::sort(loaded.begin(), loaded.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+    entries = std::move(loaded);
+    rebuildIndexes();
+    return true;
+}
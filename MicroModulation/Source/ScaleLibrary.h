@@ -0,0 +1,115 @@
+/*
+ ==============================================================================
+
+ ScaleLibrary.h
+
+ An index of a folder of Scala files (ex: the Scala archive), so scales can be searched without parsing thousands of files.
+ scan() parses new and changed files on a thread pool, and keeps the entries of files whose modification time hasn't changed.
+ The index can be saved and loaded, so a restarted host only parses files that changed since the last scan.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "JuceHeader.h"
+
+class ScaleLibrary
+{
+public:
+    /**
+     What the library knows about one file.
+     */
+    struct Entry
+    {
+        std::string path;
+        bool isKbm = false;              // false for .scl files
+        juce::int64 modificationTime = 0; // in milliseconds since 1970
+        bool isValid = false;
+        std::string error;               // why the file couldn't be parsed, if it couldn't
+        std::string description;         // the description line of a .scl file
+        int numNotes = 0;                // the notes in a .scl, or the keys in a .kbm's map
+        double periodCents = -1.0;       // the interval a .scl repeats at (its last note). -1 for .kbm files
+        juce::uint64 fingerprint = 0;    // a hash of the .scl's notes rounded to 0.1 cents. Files with the same tuning have the same fingerprint.
+        std::vector<std::string> tokens; // the lowercase words of the description and file name
+    };
+
+    /**
+     What to search for. The default Query finds every valid .scl file.
+     */
+    struct Query
+    {
+        bool isKbm = false;
+        int numNotes = -1;                   // -1 for any number of notes
+        double periodCents = -1.0;           // negative for any period
+        double periodToleranceCents = 0.5;
+        std::string text;                    // every word has to start a word of the description or file name. Empty for any.
+        bool includeInvalid = false;
+    };
+
+    ScaleLibrary();
+
+    /**
+     Finds every .scl and .kbm file in directory (and its subdirectories), and parses the ones that are new or changed.
+     Entries of files under directory that no longer exist are removed. Should not be called on the audio thread.
+     @param directory The folder to scan.
+     @return The number of files that were parsed.
+     */
+    int scan(const juce::File& directory);
+    /**
+     @return The entries that match query, sorted by path. The pointers are valid until the next scan() or loadIndex().
+     */
+    std::vector<const Entry*> find(const Query& query) const;
+    /**
+     @return The entry of the file at path, or nullptr if it isn't in the library.
+     */
+    const Entry* getEntry(const std::string& path) const;
+    int getNumEntries() const { return static_cast<int>(entries.size()); }
+
+    /**
+     Writes the index to indexFile, so a later loadIndex() and scan() only parse files that changed.
+     @return false if the file couldn't be written.
+     */
+    bool saveIndex(const juce::File& indexFile) const;
+    /**
+     Replaces the library with the index saved in indexFile.
+     @return false if the file couldn't be read. The library is left unchanged.
+     */
+    bool loadIndex(const juce::File& indexFile);
+
+    /**
+     Parses a single file into an Entry.
+     */
+    static Entry makeEntry(const juce::File& file);
+    /**
+     Splits text into lowercase words of letters and digits.
+     */
+    static std::vector<std::string> tokenize(std::string_view text);
+    /**
+     @param notes The ratios of a scale's notes to its tonic.
+     @return A hash of the notes in cents, rounded to 0.1 cents.
+     */
+    static juce::uint64 makeFingerprint(const std::vector<double>& notes);
+
+private:
+    std::vector<Entry> entries; // sorted by path
+    std::unordered_map<std::string, size_t> pathIndex;
+    std::map<int, std::vector<size_t>> numNotesIndex;
+    std::vector<std::pair<double, size_t>> periodIndex; // sorted by period
+    std::map<std::string, std::vector<size_t>> tokenIndex; // sorted, so a word finds every token it starts
+    juce::ThreadPool threadPool;
+
+    /**
+     Rebuilds the search indexes from entries. Called after entries changes.
+     */
+    void rebuildIndexes();
+    bool matches(const Entry& entry, const Query& query, const std::vector<std::string>& words) const;
+
+    JUCE_DECLARE_NON_COPYABLE(ScaleLibrary)
+};
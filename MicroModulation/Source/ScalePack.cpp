@@ -0,0 +1,213 @@
+/*
+ ==============================================================================
+
+ ScalePack.cpp
+
+ ==============================================================================
+ */
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ScalePack.h"
+
+ScalePack::ScalePack(const juce::File& packFile)
+: mappedFile(packFile, juce::MemoryMappedFile::readOnly),
+  data(static_cast<const char*>(mappedFile.getData())),
+  header(reinterpret_cast<const Header*>(data)),
+  records(nullptr),
+  valid(false)
+{
+    if(data != nullptr && mappedFile.getSize() >= sizeof(Header)) records = reinterpret_cast<const EntryRecord*>(data + sizeof(Header));
+    valid = validate();
+}
+
+bool ScalePack::validate() const
+{
+#if JUCE_BIG_ENDIAN
+    return false; // packs are read in place, so they can only be read on little-endian machines
+#endif
+    if(records == nullptr) return false;
+    if(header->magic != magic || header->version != version) return false;
+
+    const juce::uint64 size = mappedFile.getSize();
+    if(sizeof(Header) + static_cast<juce::uint64>(header->numEntries) * sizeof(EntryRecord) > size) return false;
+    for(juce::uint32 i = 0; i < header->numEntries; i++)
+    {
+        const EntryRecord& record = records[i];
+        if(record.type > static_cast<juce::uint32>(EntryType::kbm)) return false;
+        if(record.valuesOffset % alignof(double) != 0) return false;
+        if(static_cast<juce::uint64>(record.valuesOffset) + static_cast<juce::uint64>(record.numValues) * sizeof(double) > size) return false;
+        if(static_cast<juce::uint64>(record.nameOffset) + record.nameLength > size) return false;
+        if(static_cast<juce::uint64>(record.descriptionOffset) + record.descriptionLength > size) return false;
+        if(record.type == static_cast<juce::uint32>(EntryType::kbm) && record.numValues < numKbmHeaderValues) return false;
+        if(record.type == static_cast<juce::uint32>(EntryType::scl) && record.numValues == 0) return false;
+    }
+    return true;
+}
+
+ScalePack::Ptr ScalePack::open(const juce::File& packFile)
+{
+    static juce::CriticalSection lock;
+    static std::map<juce::String, Ptr> openPacks; // keyed by path and modification time, so a rebuilt pack is mapped again
+
+    const juce::ScopedLock scopedLock(lock);
+    for(auto it = openPacks.begin(); it != openPacks.end();) //unmap packs that nothing else uses anymore
+    {
+        if(it->second->getReferenceCount() == 1) it = openPacks.erase(it);
+        else ++it;
+    }
+
+    juce::String key = packFile.getFullPathName() + "@" + juce::String(packFile.getLastModificationTime().toMilliseconds());
+    auto it = openPacks.find(key);
+    if(it != openPacks.end()) return it->second;
+
+    Ptr pack = new ScalePack(packFile);
+    if(!pack->isValid()) return nullptr;
+    openPacks[key] = pack;
+    return pack;
+}
+
+int ScalePack::build(const juce::File& directory, const juce::File& packFile)
+{
+    struct Compiled
+    {
+        std::string name;
+        std::string description;
+        EntryType type;
+        std::vector<double> values;
+    };
+    std::vector<Compiled> compiled;
+
+    for(const juce::File& file : directory.findChildFiles(juce::File::findFiles, true, "*.scl;*.kbm"))
+    {
+        std::string contents;
+        if(!scala::readFile(file.getFullPathName().toStdString(), contents)) continue;
+
+        Compiled entry;
+        entry.name = file.getRelativePathFrom(directory).replaceCharacter('\\', '/').toStdString();
+        if(file.hasFileExtension("kbm"))
+        {
+            scala::KbmData kbm = scala::parseKbm(contents, -1);
+            if(!kbm.isValid) continue;
+            entry.type = EntryType::kbm;
+            entry.values = {static_cast<double>(kbm.retuneRangeLowerBound), static_cast<double>(kbm.retuneRangeUpperBound),
+                            static_cast<double>(kbm.middleNote), static_cast<double>(kbm.referenceNote),
+                            static_cast<double>(kbm.referenceFreq), static_cast<double>(kbm.formalOctaveScaleDegree)};
+            for(int scaleDegree : kbm.mapping) entry.values.push_back(scaleDegree);
+        }
+        else
+        {
+            scala::SclData scl = scala::parseScl(contents);
+            if(!scl.isValid) continue;
+            entry.type = EntryType::scl;
+            entry.description = scl.description;
+            entry.values.assign(scl.notes.begin(), scl.notes.end());
+        }
+        compiled.push_back(std::move(entry));
+    }
+    std::sort(compiled.begin(), compiled.end(), [](const Compiled& a, const Compiled& b) { return a.name < b.name; });
+
+    //lay out the file: the values come right after the entry table, which keeps them 8 byte aligned, and the strings go last
+    juce::uint64 valuesOffset = sizeof(Header) + compiled.size() * sizeof(EntryRecord);
+    juce::uint64 stringsOffset = valuesOffset;
+    for(const Compiled& entry : compiled) stringsOffset += entry.values.size() * sizeof(double);
+    juce::uint64 fileSize = stringsOffset;
+    for(const Compiled& entry : compiled) fileSize += entry.name.size() + entry.description.size();
+    if(fileSize > 0xffffffffull) return -1;
+
+    juce::MemoryOutputStream out(static_cast<size_t>(fileSize));
+    out.writeInt(static_cast<int>(magic));
+    out.writeInt(static_cast<int>(version));
+    out.writeInt(static_cast<int>(compiled.size()));
+    out.writeInt(0);
+    for(const Compiled& entry : compiled)
+    {
+        out.writeInt(static_cast<int>(stringsOffset));
+        out.writeInt(static_cast<int>(entry.name.size()));
+        stringsOffset += entry.name.size();
+        out.writeInt(static_cast<int>(stringsOffset));
+        out.writeInt(static_cast<int>(entry.description.size()));
+        stringsOffset += entry.description.size();
+        out.writeInt(static_cast<int>(valuesOffset));
+        out.writeInt(static_cast<int>(entry.values.size()));
+        valuesOffset += entry.values.size() * sizeof(double);
+        out.writeInt(static_cast<int>(entry.type));
+        out.writeInt(0);
+    }
+    for(const Compiled& entry : compiled)
+    {
+        for(double value : entry.values) out.writeDouble(value);
+    }
+    for(const Compiled& entry : compiled)
+    {
+        out.write(entry.name.data(), entry.name.size());
+        out.write(entry.description.data(), entry.description.size());
+    }
+
+    if(!packFile.replaceWithData(out.getData(), out.getDataSize())) return -1;
+    return static_cast<int>(compiled.size());
+}
+
+ScalePack::Entry ScalePack::getEntry(int index) const
+{
+    jassert(index >= 0 && index < getNumEntries());
+    const EntryRecord& record = records[index];
+    return {std::string_view(data + record.nameOffset, record.nameLength),
+            std::string_view(data + record.descriptionOffset, record.descriptionLength),
+            static_cast<EntryType>(record.type),
+            reinterpret_cast<const double*>(data + record.valuesOffset),
+            static_cast<int>(record.numValues)};
+}
+
+int ScalePack::findEntry(std::string_view name) const
+{
+    int low = 0;
+    int high = getNumEntries();
+    while(low < high) //the entries are sorted by name
+    {
+        int middle = (low + high) / 2;
+        std::string_view middleName = getEntry(middle).name;
+        if(middleName == name) return middle;
+        if(middleName < name) low = middle + 1;
+        else high = middle;
+    }
+    return -1;
+}
+
+scala::SclData ScalePack::getScl(int index) const
+{
+    scala::SclData scl;
+    Entry entry = getEntry(index);
+    if(entry.type != EntryType::scl)
+    {
+        scl.error = "the entry isn't a .scl";
+        return scl;
+    }
+    scl.description.assign(entry.description.data(), entry.description.size());
+    scl.notes.assign(entry.values, entry.values + entry.numValues);
+    scl.isValid = true;
+    return scl;
+}
+
+scala::KbmData ScalePack::getKbm(int index) const
+{
+    scala::KbmData kbm;
+    Entry entry = getEntry(index);
+    if(entry.type != EntryType::kbm)
+    {
+        kbm.error = "the entry isn't a .kbm";
+        return kbm;
+    }
+    kbm.retuneRangeLowerBound = static_cast<int>(entry.values[retuneRangeLowerBound]);
+    kbm.retuneRangeUpperBound = static_cast<int>(entry.values[retuneRangeUpperBound]);
+    kbm.middleNote = static_cast<int>(entry.values[middleNote]);
+    kbm.referenceNote = static_cast<int>(entry.values[referenceNote]);
+    kbm.referenceFreq = static_cast<float>(entry.values[referenceFreq]);
+    kbm.formalOctaveScaleDegree = static_cast<int>(entry.values[formalOctaveScaleDegree]);
+    for(int i = numKbmHeaderValues; i < entry.numValues; i++) kbm.mapping.push_back(static_cast<int>(entry.values[i]));
+    kbm.isValid = true;
+    return kbm;
+}
@@ -0,0 +1,139 @@
+/*
+ ==============================================================================
+
+ ScalePack.h
+
+ A compact binary file holding many parsed .scl and .kbm files, so a preset can be recalled without reading or parsing any text.
+ A pack is memory mapped, and packs are shared through open(), so every instance in a process that uses the same pack
+ reads the same mapped pages.
+
+ The layout (every value is little-endian):
+   Header       magic "MMSP", version, number of entries, reserved                     4 x uint32
+   Entry table  one EntryRecord per entry, sorted by name                               8 x uint32 each
+   Values       the values of every entry, as contiguous doubles                        8 byte aligned
+   Strings      the name and description of every entry, in UTF-8 (not null terminated)
+ A .scl entry's values are its note ratios. A .kbm entry's values are its 6 header values (see KbmHeaderValue),
+ followed by its mapping, where unmapped keys are -1.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <string_view>
+
+#include "JuceHeader.h"
+
+#include "ScalaParser.h"
+
+class ScalePack : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<ScalePack>;
+
+    static constexpr juce::uint32 magic = 0x50534d4d; // "MMSP", read as a little-endian uint32
+    static constexpr juce::uint32 version = 1;
+
+    enum class EntryType : juce::uint32
+    {
+        scl = 0,
+        kbm = 1
+    };
+    /**
+     The order of the values at the start of a .kbm entry.
+     */
+    enum KbmHeaderValue
+    {
+        retuneRangeLowerBound = 0,
+        retuneRangeUpperBound,
+        middleNote,
+        referenceNote,
+        referenceFreq,
+        formalOctaveScaleDegree,
+        numKbmHeaderValues
+    };
+
+    /**
+     A view of one entry. It points into the mapped file, so it is only valid while the pack is.
+     */
+    struct Entry
+    {
+        std::string_view name;        // the path of the file the entry was built from, relative to the pack's directory, with '/' separators
+        std::string_view description; // empty for .kbm entries
+        EntryType type;
+        const double* values;
+        int numValues;
+    };
+
+    /**
+     Maps packFile into memory. Use isValid() to check that it is a pack.
+     Prefer open(), which shares a mapping between everything that uses the same pack.
+     */
+    explicit ScalePack(const juce::File& packFile);
+
+    /**
+     @return The pack at packFile, shared with every other caller that opened the same (unmodified) file.
+     nullptr if the file isn't a valid pack.
+     */
+    static Ptr open(const juce::File& packFile);
+
+    /**
+     Compiles every .scl and .kbm file in directory (and its subdirectories) into a pack. Files that can't be parsed are skipped.
+     Should not be called on the audio thread.
+     @param directory The folder of Scala files.
+     @param packFile Where to write the pack. It is replaced if it exists.
+     @return The number of entries in the pack, or -1 if it couldn't be written.
+     */
+    static int build(const juce::File& directory, const juce::File& packFile);
+
+    bool isValid() const { return valid; }
+    int getNumEntries() const { return valid ? static_cast<int>(header->numEntries) : 0; }
+    Entry getEntry(int index) const;
+    /**
+     @return The index of the entry called name, or -1 if there isn't one.
+     */
+    int findEntry(std::string_view name) const;
+
+    /**
+     Copies a .scl entry into an SclData, so it can be loaded like a parsed file.
+     isValid is false if the entry isn't a .scl entry.
+     */
+    scala::SclData getScl(int index) const;
+    /**
+     Copies a .kbm entry into a KbmData. isValid is false if the entry isn't a .kbm entry.
+     */
+    scala::KbmData getKbm(int index) const;
+
+private:
+    struct Header
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::uint32 numEntries;
+        juce::uint32 reserved;
+    };
+    struct EntryRecord
+    {
+        juce::uint32 nameOffset;
+        juce::uint32 nameLength;
+        juce::uint32 descriptionOffset;
+        juce::uint32 descriptionLength;
+        juce::uint32 valuesOffset;
+        juce::uint32 numValues;
+        juce::uint32 type;
+        juce::uint32 reserved;
+    };
+
+    juce::MemoryMappedFile mappedFile;
+    const char* data;
+    const Header* header;
+    const EntryRecord* records;
+    bool valid;
+
+    /**
+     @return true if the mapped file has a valid header, and every entry's offsets are inside the file.
+     */
+    bool validate() const;
+
+    JUCE_DECLARE_NON_COPYABLE(ScalePack)
+};
@@ -0,0 +1,243 @@
+/*
+ ==============================================================================
+
+ TuningCache.cpp
+
+ ==============================================================================
+ */
+
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+#include "TuningCache.h"
+
+CompiledTuning::CompiledTuning(const std::vector<double>& noteRatios, const std::vector<juce::int16>& scaleDegrees,
+                               int middleNote, int formalOctaveScaleDegree, double fundamentalPitch)
+: noteRatios(noteRatios), scaleDegrees(scaleDegrees), middleNote(middleNote),
+  formalOctaveScaleDegree(formalOctaveScaleDegree), fundamentalPitch(fundamentalPitch)
+{
+    noteSemitones.resize(noteRatios.size());
+    juce::Array<juce::var> notes;
+    for(size_t i = 0; i < noteRatios.size(); i++)
+    {
+        noteSemitones[i] = 12.0 * std::log2(noteRatios[i]);
+        notes.add(noteRatios[i]);
+    }
+    notesValue = notes;
+
+    const int numNotes = static_cast<int>(noteSemitones.size());
+    const int mappingSize = static_cast<int>(scaleDegrees.size());
+    if(mappingSize == 0 || numNotes == 0) //nothing is loaded
+    {
+        pitchTable.fill(std::numeric_limits<double>::quiet_NaN());
+        freqTable.fill(-1.0f);
+        return;
+    }
+
+    //a note's pitch is computed from the key below it (see the git history of Scale::getFreq() for why).
+    //the key and octave only need one division, for the first note. Then they are stepped along the keyboard
+    std::array<double, 128> degreeSemitones; //the semitones of each note's scale degree, or 0 if it is unmapped
+    std::array<double, 128> octaves;
+    std::array<bool, 128> isMapped;
+    const int firstOffset = -1 - middleNote;
+    int octave = (firstOffset >= 0 ? firstOffset : firstOffset - mappingSize + 1) / mappingSize; //rounds down
+    int key = firstOffset - octave * mappingSize;
+    for(size_t note = 0; note < pitchTable.size(); note++)
+    {
+        int scaleDegree = scaleDegrees[static_cast<size_t>(key)];
+        isMapped[note] = scaleDegree >= 0 && scaleDegree < numNotes;
+        degreeSemitones[note] = isMapped[note] ? noteSemitones[static_cast<size_t>(scaleDegree)] : 0.0;
+        octaves[note] = octave;
+        if(++key == mappingSize)
+        {
+            key = 0;
+            octave++;
+        }
+    }
+    const bool isOctaveMapped = formalOctaveScaleDegree >= 0 && formalOctaveScaleDegree < numNotes;
+    const double octaveSemitones = isOctaveMapped ? noteSemitones[static_cast<size_t>(formalOctaveScaleDegree)]
+                                                  : std::numeric_limits<double>::quiet_NaN();
+    //no branches, so this can be vectorised. The unmapped notes are masked afterwards
+    for(size_t note = 0; note < pitchTable.size(); note++)
+    {
+        pitchTable[note] = fundamentalPitch + degreeSemitones[note] + octaves[note] * octaveSemitones;
+    }
+    for(size_t note = 0; note < pitchTable.size(); note++)
+    {
+        if(!isMapped[note]) pitchTable[note] = std::numeric_limits<double>::quiet_NaN();
+    }
+    for(size_t note = 0; note < pitchTable.size(); note++)
+    {
+        freqTable[note] = std::isnan(pitchTable[note]) ? -1.0f : static_cast<float>(440.0 * std::exp2((pitchTable[note] - 69.0) / 12.0));
+    }
+}
+
+bool CompiledTuning::matches(const std::vector<double>& otherNoteRatios, const std::vector<juce::int16>& otherScaleDegrees,
+                             int otherMiddleNote, int otherFormalOctaveScaleDegree, double otherFundamentalPitch) const
+{
+    //compared bit for bit, like makeHash(), so that NaNs match each other
+    return middleNote == otherMiddleNote
+           && formalOctaveScaleDegree == otherFormalOctaveScaleDegree
+           && std::memcmp(&fundamentalPitch, &otherFundamentalPitch, sizeof(double)) == 0
+           && noteRatios.size() == otherNoteRatios.size()
+           && std::memcmp(noteRatios.data(), otherNoteRatios.data(), noteRatios.size() * sizeof(double)) == 0
+           && scaleDegrees == otherScaleDegrees;
+}
+
+juce::uint64 CompiledTuning::makeHash(const std::vector<double>& noteRatios, const std::vector<juce::int16>& scaleDegrees,
+                                      int middleNote, int formalOctaveScaleDegree, double fundamentalPitch)
+{
+    juce::uint64 hash = TuningCache::hashBytes(noteRatios.data(), noteRatios.size() * sizeof(double));
+    hash = TuningCache::hashBytes(scaleDegrees.data(), scaleDegrees.size() * sizeof(juce::int16), hash);
+    hash = TuningCache::hashBytes(&middleNote, sizeof(int), hash);
+    hash = TuningCache::hashBytes(&formalOctaveScaleDegree, sizeof(int), hash);
+    return TuningCache::hashBytes(&fundamentalPitch, sizeof(double), hash);
+}
+
+namespace
+{
+    /**
+     A parse of a .scl or .kbm text. The text is kept so that a hash collision can't return the wrong parse.
+     */
+    template <typename Data>
+    struct ParsedText
+    {
+        juce::uint64 hash;
+        std::string text;
+        int scaleLength;
+        std::shared_ptr<const Data> data;
+    };
+
+    struct Entries
+    {
+        juce::CriticalSection lock;
+        std::unordered_multimap<juce::uint64, CompiledTuning::Ptr> tunings;
+        int numCompiles = 0;
+        std::deque<ParsedText<scala::SclData>> sclParses; // the most recent parses, oldest first
+        std::deque<ParsedText<scala::KbmData>> kbmParses;
+    };
+    Entries& getEntries()
+    {
+        static Entries entries;
+        return entries;
+    }
+
+    /**
+     Removes the tunings that nothing outside of the cache is using. Must be called with the lock held.
+     */
+    void purgeUnused(Entries& entries)
+    {
+        for(auto it = entries.tunings.begin(); it != entries.tunings.end();)
+        {
+            if(it->second->getReferenceCount() == 1) it = entries.tunings.erase(it);
+            else ++it;
+        }
+    }
+
+    /**
+     @return The recent parse of text, or nullptr. Must be called with the lock held.
+     */
+    template <typename Data>
+    std::shared_ptr<const Data> findParse(const std::deque<ParsedText<Data>>& parses, juce::uint64 hash, std::string_view text, int scaleLength)
+    {
+        for(const auto& parsed : parses)
+        {
+            if(parsed.hash == hash && parsed.scaleLength == scaleLength && parsed.text == text) return parsed.data;
+        }
+        return nullptr;
+    }
+
+    /**
+     A parse is only needed while a file is being loaded, so rather than waiting for it to be unused,
+     the most recent ones are kept (ex: for every instance in a session loading the same file).
+     The text is parsed without holding the lock, so a long file doesn't hold up every other load in the process.
+     If another thread parsed the same text in the meantime, its parse is kept and this one is dropped.
+     */
+    template <typename Data, typename ParseFunction>
+    std::shared_ptr<const Data> findOrParse(Entries& entries, std::deque<ParsedText<Data>>& parses, std::string_view text, int scaleLength,
+                                            ParseFunction parse)
+    {
+        juce::uint64 hash = TuningCache::hashBytes(text.data(), text.size());
+        hash = TuningCache::hashBytes(&scaleLength, sizeof(int), hash);
+        {
+            const juce::ScopedLock scopedLock(entries.lock);
+            if(auto found = findParse(parses, hash, text, scaleLength)) return found;
+        }
+        auto data = std::make_shared<const Data>(parse(text));
+
+        const juce::ScopedLock scopedLock(entries.lock);
+        if(auto found = findParse(parses, hash, text, scaleLength)) return found;
+        if(parses.size() == TuningCache::maxRecentParses) parses.pop_front();
+        parses.push_back({hash, std::string(text), scaleLength, data});
+        return data;
+    }
+}
+
+CompiledTuning::Ptr TuningCache::getTuning(const std::vector<double>& noteRatios, const std::vector<juce::int16>& scaleDegrees,
+                                           int middleNote, int formalOctaveScaleDegree, double fundamentalPitch)
+{
+    juce::uint64 hash = CompiledTuning::makeHash(noteRatios, scaleDegrees, middleNote, formalOctaveScaleDegree, fundamentalPitch);
+    Entries& entries = getEntries();
+    const juce::ScopedLock scopedLock(entries.lock);
+
+    auto range = entries.tunings.equal_range(hash);
+    for(auto it = range.first; it != range.second; it++)
+    {
+        if(it->second->matches(noteRatios, scaleDegrees, middleNote, formalOctaveScaleDegree, fundamentalPitch)) return it->second;
+    }
+    purgeUnused(entries); //the tunings that were replaced by loads are dropped here, so they don't pile up
+    entries.numCompiles++;
+    CompiledTuning::Ptr tuning = new CompiledTuning(noteRatios, scaleDegrees, middleNote, formalOctaveScaleDegree, fundamentalPitch);
+    entries.tunings.emplace(hash, tuning);
+    return tuning;
+}
+
+std::shared_ptr<const scala::SclData> TuningCache::parseScl(std::string_view sclText)
+{
+    Entries& entries = getEntries();
+    return findOrParse(entries, entries.sclParses, sclText, -1, [](std::string_view text) { return scala::parseScl(text); });
+}
+
+std::shared_ptr<const scala::KbmData> TuningCache::parseKbm(std::string_view kbmText, int scaleLength)
+{
+    Entries& entries = getEntries();
+    return findOrParse(entries, entries.kbmParses, kbmText, scaleLength,
+                       [scaleLength](std::string_view text) { return scala::parseKbm(text, scaleLength); });
+}
+
+int TuningCache::getNumTunings()
+{
+    Entries& entries = getEntries();
+    const juce::ScopedLock scopedLock(entries.lock);
+    purgeUnused(entries);
+    return static_cast<int>(entries.tunings.size());
+}
+
+int TuningCache::getNumCompiles()
+{
+    Entries& entries = getEntries();
+    const juce::ScopedLock scopedLock(entries.lock);
+    return entries.numCompiles;
+}
+
+void TuningCache::purge()
+{
+    Entries& entries = getEntries();
+    const juce::ScopedLock scopedLock(entries.lock);
+    purgeUnused(entries);
+}
+
+juce::uint64 TuningCache::hashBytes(const void* data, size_t size, juce::uint64 hash)
+{
+    const auto* bytes = static_cast<const juce::uint8*>(data);
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,126 @@
+/*
+ ==============================================================================
+
+ TuningCache.h
+
+ Shares parsed and compiled tunings between every Scale in the process, so that many plugin instances
+ using the same .scl and .kbm parse it once and read the same tables.
+ A CompiledTuning holds everything about a tuning that doesn't change after it is loaded: the note ratios,
+ the keyboard mapping, and the pitch and frequency tables. It is never modified once it is compiled, so it
+ can be shared without locking. Each Scale keeps its own modulation offset (and its own ValueTree, for undo and the UI).
+ Entries are keyed by a hash of their contents. Compiled tunings are dropped once no Scale uses them,
+ and only the most recent parses are kept.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "ScalaParser.h"
+
+class CompiledTuning : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<CompiledTuning>;
+
+    /**
+     Compiles the pitch of every midi note. Prefer TuningCache::getTuning(), which shares the result.
+     @param noteRatios The ratio of each note of the scale to the tonic.
+     @param scaleDegrees The scale degree of each key in the mapping pattern, or -1 for unmapped keys.
+     @param middleNote The midi note that the first key of the pattern is on.
+     @param formalOctaveScaleDegree The scale degree the pattern repeats at.
+     @param fundamentalPitch The pitch of the middle note's octave (see Scale::getFundamentalPitch()).
+     */
+    CompiledTuning(const std::vector<double>& noteRatios, const std::vector<juce::int16>& scaleDegrees,
+                   int middleNote, int formalOctaveScaleDegree, double fundamentalPitch);
+
+    const std::vector<double>& getNoteRatios() const { return noteRatios; }
+    /**
+     @return getNoteRatios() as a juce::var array, for the scaleNotes property of Scale's ValueTree.
+     A var only holds a reference to its array, so every Scale with this tuning shares one copy. It must not be edited.
+     */
+    const juce::var& getNotesValue() const { return notesValue; }
+    /**
+     @return getNoteRatios() in semitones.
+     */
+    const std::vector<double>& getNoteSemitones() const { return noteSemitones; }
+    /**
+     @return The pitch of midiNoteNum before any modulations, or NaN if the note isn't mapped.
+     */
+    double getPitch(int midiNoteNum) const { return pitchTable[static_cast<size_t>(midiNoteNum)]; }
+    /**
+     @return getPitch() in Hz, or -1 if the note isn't mapped.
+     */
+    float getFreq(int midiNoteNum) const { return freqTable[static_cast<size_t>(midiNoteNum)]; }
+
+    /**
+     @return true if this tuning was compiled from exactly these values.
+     */
+    bool matches(const std::vector<double>& otherNoteRatios, const std::vector<juce::int16>& otherScaleDegrees,
+                 int otherMiddleNote, int otherFormalOctaveScaleDegree, double otherFundamentalPitch) const;
+    /**
+     @return A hash of the values a tuning is compiled from. Equal values always have the same hash.
+     */
+    static juce::uint64 makeHash(const std::vector<double>& noteRatios, const std::vector<juce::int16>& scaleDegrees,
+                                 int middleNote, int formalOctaveScaleDegree, double fundamentalPitch);
+
+private:
+    const std::vector<double> noteRatios;
+    const std::vector<juce::int16> scaleDegrees;
+    const int middleNote;
+    const int formalOctaveScaleDegree;
+    const double fundamentalPitch;
+    std::vector<double> noteSemitones;
+    juce::var notesValue;
+    std::array<double, 128> pitchTable; //the pitch of every midi note, compiled once so that reading it never computes anything
+    std::array<float, 128> freqTable;   //pitchTable in Hz
+
+    JUCE_DECLARE_NON_COPYABLE(CompiledTuning)
+};
+
+class TuningCache
+{
+public:
+    static constexpr size_t maxRecentParses = 32; // the number of .scl (and .kbm) parses that are kept
+
+    /**
+     @return The tuning compiled from these values, shared with every other caller that asked for the same values.
+     It is only compiled if nothing in the process is using it already. See CompiledTuning().
+     */
+    static CompiledTuning::Ptr getTuning(const std::vector<double>& noteRatios, const std::vector<juce::int16>& scaleDegrees,
+                                         int middleNote, int formalOctaveScaleDegree, double fundamentalPitch);
+    /**
+     @return The parse of sclText, shared with every other caller that recently parsed the same text. See scala::parseScl().
+     */
+    static std::shared_ptr<const scala::SclData> parseScl(std::string_view sclText);
+    /**
+     @return The parse of kbmText, shared with every other caller that recently parsed the same text for the same scale length.
+     See scala::parseKbm().
+     */
+    static std::shared_ptr<const scala::KbmData> parseKbm(std::string_view kbmText, int scaleLength);
+
+    /**
+     @return The number of compiled tunings that are in use somewhere in the process.
+     */
+    static int getNumTunings();
+    /**
+     @return The number of tunings that have been compiled since the process started (not counting the ones found in the cache).
+     */
+    static int getNumCompiles();
+    /**
+     Drops every compiled tuning that only the cache is using.
+     */
+    static void purge();
+
+    /**
+     @return The 64 bit FNV-1a hash of size bytes of data, continuing from hash.
+     */
+    static juce::uint64 hashBytes(const void* data, size_t size, juce::uint64 hash = 14695981039346656037ull);
+};
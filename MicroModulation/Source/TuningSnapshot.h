@@ -0,0 +1,144 @@
+/*
+ ==============================================================================
+
+ TuningSnapshot.h
+
+ An immutable copy of everything the audio thread needs to retune midi.
+ Snapshots are compiled from a Scale on the message thread, and handed to the audio thread by MidiProcessor
+ through an atomic pointer swap. Once constructed, a snapshot is never modified, so the audio thread can
+ read it without locking while the message thread builds the next one.
+ Modulations don't need a new snapshot. The snapshot holds the modulation offset it was published with,
+ and later modulations reach the audio thread as a new offset (see MidiProcessor::modulate()).
+ It also holds each key's scale degree in semitones, so modulations triggered from the midi stream can be worked out on the audio thread.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <string>
+
+#include "JuceHeader.h"
+
+#include "RetuneTable.h"
+#include "Scale.h"
+
+class TuningSnapshot : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<TuningSnapshot>;
+
+    /**
+     A fixed channel for each distinct pitchbend (bend class) in the tuning.
+     Each channel's pitchbend only needs to be sent once, when the snapshot starts being used.
+     */
+    struct StaticChannelLayout
+    {
+        int numBendClasses;
+        int channels[RetuneTable::numMidiNotes];  // the channel each input note is played on, or -1 if it is unmapped
+        int bendClassChannels[16];                // the channel of each bend class
+        juce::uint16 bendClassPitchWheels[16];    // the pitch wheel position of each bend class (without modulation)
+        int bendClassNotes[16];                   // an input note of each bend class, to find the class's pitch wheel after a modulation
+    };
+
+    /**
+     Compiles a snapshot of scale. Should not be called on the audio thread.
+     @param scale The Scale to compile.
+     @param zone The MPE zone that notes will be played in. Gives the pitchbend range and member channels.
+     @param wantsStaticChannelLayout If true, and the tuning has no more bend classes than zone has member channels,
+     a StaticChannelLayout is compiled as well.
+     @param generation Identifies this snapshot, so the audio thread can tell which snapshot a modulation offset was published for.
+     */
+    TuningSnapshot(Scale& scale, const juce::MPEZoneLayout::Zone& zone, bool wantsStaticChannelLayout, int generation = 0)
+    : hasScl(scale.hasSclLoaded()), description(scale.getDescription()), generation(generation),
+      modulationOffset(RetuneTable::toFixedOffset(scale.getModulationOffset()))
+    {
+        retuneTable.compile(scale, static_cast<float>(zone.perNotePitchbendRange));
+        for(int note = 0; note < RetuneTable::numMidiNotes; note++)
+        {
+            noteSemitones[note] = hasScl ? scale.getNoteSemitones(note) : std::numeric_limits<double>::quiet_NaN();
+        }
+        hasStaticLayout = wantsStaticChannelLayout && hasScl
+                          && compileStaticChannelLayout(zone.getFirstMemberChannel(), zone.getLastMemberChannel());
+        numSnapshots++;
+    }
+    ~TuningSnapshot() override { numSnapshots--; }
+
+    /**
+     @return The number of snapshots in the process that haven't been deleted. A retired snapshot counts until it is released.
+     */
+    static int getNumSnapshots() { return numSnapshots.load(); }
+
+    const RetuneTable& getRetuneTable() const { return retuneTable; }
+    bool hasSclLoaded() const { return hasScl; }
+    /**
+     @return true if every bend class in this tuning has its own channel, so no per-note pitchbend is needed.
+     */
+    bool hasStaticChannelLayout() const { return hasStaticLayout; }
+    const StaticChannelLayout& getStaticChannelLayout() const { return staticLayout; }
+    
+    /**
+     @return The description of the scale, used as the name of MTS bulk tuning dumps.
+     */
+    const std::string& getDescription() const { return description; }
+    int getGeneration() const { return generation; }
+    /**
+     @return The fixed point modulation offset (see RetuneTable::toFixedOffset()) when the snapshot was published.
+     */
+    juce::int64 getModulationOffset() const { return modulationOffset; }
+    /**
+     The same as Scale::getModulationInterval(), but safe to call on the audio thread.
+     @return The semitones that modulating from center to pivot adds to every pitch, or NaN if either note isn't mapped.
+     */
+    double getModulationInterval(int center, int pivot) const
+    {
+        if(center < 0 || center >= RetuneTable::numMidiNotes || pivot < 0 || pivot >= RetuneTable::numMidiNotes)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return noteSemitones[pivot] - noteSemitones[center];
+    }
+
+private:
+    RetuneTable retuneTable;
+    const bool hasScl;
+    const std::string description;
+    const int generation;
+    const juce::int64 modulationOffset;
+    double noteSemitones[RetuneTable::numMidiNotes]; // Scale::getNoteSemitones() of each key. NaN if it is unmapped
+    bool hasStaticLayout;
+    StaticChannelLayout staticLayout;
+    static inline std::atomic<int> numSnapshots { 0 };
+
+    /**
+     @return false if there are more bend classes than channels.
+     */
+    bool compileStaticChannelLayout(int firstChannel, int lastChannel)
+    {
+        int maxBendClasses = juce::jmin(16, lastChannel - firstChannel + 1);
+        staticLayout.numBendClasses = 0;
+        for(int note = 0; note < RetuneTable::numMidiNotes; note++)
+        {
+            const RetuneTable::Entry& entry = retuneTable[note];
+            staticLayout.channels[note] = -1;
+            if(!entry.isMapped) continue;
+
+            int bendClass = 0;
+            while(bendClass < staticLayout.numBendClasses && staticLayout.bendClassPitchWheels[bendClass] != entry.pitchWheel) bendClass++;
+            if(bendClass == staticLayout.numBendClasses)
+            {
+                if(bendClass == maxBendClasses) return false;
+                staticLayout.bendClassPitchWheels[bendClass] = entry.pitchWheel;
+                staticLayout.bendClassChannels[bendClass] = firstChannel + bendClass;
+                staticLayout.bendClassNotes[bendClass] = note;
+                staticLayout.numBendClasses++;
+            }
+            staticLayout.channels[note] = staticLayout.bendClassChannels[bendClass];
+        }
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE(TuningSnapshot)
+};
@@ -0,0 +1,177 @@
+/*
+ ==============================================================================
+
+ UniversalMidiPackets.h
+
+ A namespace of functions for building MIDI 2.0 Universal MIDI Packets (UMP), and a fixed size buffer to hold them.
+ These are used by MidiProcessor as an alternative to MPE, for synths that support MIDI 2.0 per-note pitch.
+ Each note on carries its pitch as a 7.9 attribute, followed by a per-note pitch bend with the rest of the
+ 7.25 fixed point pitch, so there is no channel rotation and no 14-bit pitchbend quantization.
+ Like MidiTuningStandard.h, every function writes into a caller-provided buffer, so they can be used on the audio thread.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "RetuneTable.h"
+
+namespace ump {
+
+static constexpr juce::uint32 systemType = 0x1;             // 32 bit packets, holding a system common or real-time message
+static constexpr juce::uint32 midi1ChannelVoiceType = 0x2; // 32 bit packets, holding a MIDI 1.0 message
+static constexpr juce::uint32 midi2ChannelVoiceType = 0x4; // 64 bit packets
+static constexpr juce::uint32 noteOffStatus = 0x8;
+static constexpr juce::uint32 noteOnStatus = 0x9;
+static constexpr juce::uint32 perNotePitchBendStatus = 0x6;
+static constexpr juce::uint8 pitchAttributeType = 0x3;       // attribute data is the pitch of the note in 7.9 fixed point
+static constexpr int pitchAttributeFractionBits = 9;
+static constexpr juce::uint32 centeredPitchBend = 0x80000000u;
+static constexpr int maxWordsPerPacket = 4;
+
+/**
+ Scales a 7 bit value up to 16 bits, using the MIDI 2.0 min-center-max scaling: 0 stays 0, 64 stays centered, and 127 becomes 0xffff.
+ */
+inline juce::uint16 scaleUp7To16(juce::uint8 value)
+{
+    juce::uint32 scaled = static_cast<juce::uint32>(value & 0x7f) << 9;
+    if(value <= 64) return static_cast<juce::uint16>(scaled);
+    juce::uint32 repeatBits = value & 0x3f; // everything after the most significant bit is repeated to fill the lower bits
+    return static_cast<juce::uint16>(scaled | (repeatBits << 3) | (repeatBits >> 3));
+}
+
+/**
+ Writes a 64 bit MIDI 2.0 note on, with the pitch attribute set to fixedPitch.
+ @param group The UMP group, on [0, 15].
+ @param channel The channel, on [1, 16].
+ @param noteNumber The note number, on [0, 127].
+ @param velocity The MIDI 1.0 velocity, which is scaled up to 16 bits.
+ @param fixedPitch The pitch of the note in 7.25 fixed point. Only the top 7.9 bits fit in the attribute.
+ @param dest Where to write 2 words.
+ @return The number of words written.
+ */
+inline int writeNoteOnWithPitch(int group, int channel, int noteNumber, juce::uint8 velocity, juce::uint32 fixedPitch, juce::uint32* dest)
+{
+    auto pitch7_9 = static_cast<juce::uint16>(fixedPitch >> (RetuneTable::pitchFractionBits - pitchAttributeFractionBits));
+    dest[0] = (midi2ChannelVoiceType << 28) | (static_cast<juce::uint32>(group & 0xf) << 24)
+              | (((noteOnStatus << 4) | static_cast<juce::uint32>((channel - 1) & 0xf)) << 16)
+              | (static_cast<juce::uint32>(noteNumber & 0x7f) << 8) | pitchAttributeType;
+    dest[1] = (static_cast<juce::uint32>(scaleUp7To16(velocity)) << 16) | pitch7_9;
+    return 2;
+}
+/**
+ Writes a 64 bit MIDI 2.0 note off, with no attribute.
+ @return The number of words written.
+ */
+inline int writeNoteOff(int group, int channel, int noteNumber, juce::uint8 velocity, juce::uint32* dest)
+{
+    dest[0] = (midi2ChannelVoiceType << 28) | (static_cast<juce::uint32>(group & 0xf) << 24)
+              | (((noteOffStatus << 4) | static_cast<juce::uint32>((channel - 1) & 0xf)) << 16)
+              | (static_cast<juce::uint32>(noteNumber & 0x7f) << 8);
+    dest[1] = static_cast<juce::uint32>(scaleUp7To16(velocity)) << 16;
+    return 2;
+}
+/**
+ Writes a 64 bit MIDI 2.0 per-note pitch bend.
+ @param bend The 32 bit bend, where centeredPitchBend is no bend.
+ @return The number of words written.
+ */
+inline int writePerNotePitchBend(int group, int channel, int noteNumber, juce::uint32 bend, juce::uint32* dest)
+{
+    dest[0] = (midi2ChannelVoiceType << 28) | (static_cast<juce::uint32>(group & 0xf) << 24)
+              | (((perNotePitchBendStatus << 4) | static_cast<juce::uint32>((channel - 1) & 0xf)) << 16)
+              | (static_cast<juce::uint32>(noteNumber & 0x7f) << 8);
+    dest[1] = bend;
+    return 2;
+}
+/**
+ @param fixedPitch The pitch of the note in 7.25 fixed point.
+ @param pitchBendRange The per-note pitch bend range (in semitones) of the receiving synth.
+ @return The per-note pitch bend that adds the part of fixedPitch that doesn't fit in the 7.9 pitch attribute.
+ */
+inline juce::uint32 getResidualPitchBend(juce::uint32 fixedPitch, int pitchBendRange)
+{
+    constexpr int residualBits = RetuneTable::pitchFractionBits - pitchAttributeFractionBits;
+    juce::uint64 residual = fixedPitch & ((1u << residualBits) - 1u);
+    // a bend of pitchBendRange semitones is 2^31 steps, and a semitone is 2^25 fixed point steps.
+    return centeredPitchBend + static_cast<juce::uint32>((residual << 6) / static_cast<juce::uint64>(juce::jmax(1, pitchBendRange)));
+}
+/**
+ Writes a 32 bit packet holding a MIDI 1.0 channel voice message (ex: a controller or channel pressure).
+ @param bytes The 3 (or fewer) bytes of the message.
+ @return The number of words written.
+ */
+inline int writeMidi1ChannelVoice(int group, const juce::uint8* bytes, int numBytes, juce::uint32* dest)
+{
+    dest[0] = (midi1ChannelVoiceType << 28) | (static_cast<juce::uint32>(group & 0xf) << 24)
+              | (static_cast<juce::uint32>(bytes[0]) << 16)
+              | (numBytes > 1 ? static_cast<juce::uint32>(bytes[1] & 0x7f) << 8 : 0u)
+              | (numBytes > 2 ? static_cast<juce::uint32>(bytes[2] & 0x7f) : 0u);
+    return 1;
+}
+/**
+ Writes a 32 bit packet holding a system common or real-time message (status 0xf1 and up, ex: clock, start, or song position).
+ @param bytes The 3 (or fewer) bytes of the message.
+ @return The number of words written.
+ */
+inline int writeSystem(int group, const juce::uint8* bytes, int numBytes, juce::uint32* dest)
+{
+    dest[0] = (systemType << 28) | (static_cast<juce::uint32>(group & 0xf) << 24)
+              | (static_cast<juce::uint32>(bytes[0]) << 16)
+              | (numBytes > 1 ? static_cast<juce::uint32>(bytes[1] & 0x7f) << 8 : 0u)
+              | (numBytes > 2 ? static_cast<juce::uint32>(bytes[2] & 0x7f) : 0u);
+    return 1;
+}
+
+/**
+ A list of timestamped packets, preallocated with ensureSize() so that adding packets never allocates.
+ */
+class PacketBuffer
+{
+public:
+    struct Packet
+    {
+        int samplePosition;
+        int numWords;
+        juce::uint32 words[maxWordsPerPacket];
+    };
+
+    PacketBuffer() : numPackets(0) {}
+
+    /**
+     Makes room for maxPackets. Must not be called on the audio thread.
+     */
+    void ensureSize(int maxPackets)
+    {
+        if(static_cast<int>(packets.size()) < maxPackets) packets.resize(static_cast<size_t>(maxPackets));
+    }
+    void clear() { numPackets = 0; }
+    /**
+     @return false if the buffer is full, and the packet was dropped.
+     */
+    bool add(const juce::uint32* words, int numWords, int samplePosition)
+    {
+        jassert(numWords > 0 && numWords <= maxWordsPerPacket);
+        if(numPackets == static_cast<int>(packets.size())) return false;
+        Packet& packet = packets[static_cast<size_t>(numPackets++)];
+        packet.samplePosition = samplePosition;
+        packet.numWords = numWords;
+        for(int i = 0; i < numWords; i++) packet.words[i] = words[i];
+        return true;
+    }
+
+    int getNumPackets() const { return numPackets; }
+    const Packet& operator[](int index) const { return packets[static_cast<size_t>(index)]; }
+    const Packet* begin() const { return packets.data(); }
+    const Packet* end() const { return packets.data() + numPackets; }
+
+private:
+    std::vector<Packet> packets;
+    int numPackets;
+};
+
+}  // end namespace ump
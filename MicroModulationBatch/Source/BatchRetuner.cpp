@@ -0,0 +1,173 @@
+/*
+ ==============================================================================
+
+ BatchRetuner.cpp
+
+ ==============================================================================
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <sstream>
+
+#include "BatchRetuner.h"
+
+bool BatchRetuner::parseScript(std::string_view scriptText, std::vector<ScriptEvent>& script, std::string& error)
+{
+    std::vector<ScriptEvent> events;
+    std::istringstream lines{std::string(scriptText)};
+    std::string line;
+    for(int lineNum = 1; std::getline(lines, line); lineNum++)
+    {
+        std::istringstream words(line);
+        std::string first;
+        if(!(words >> first) || first[0] == '!' || first[0] == '#') continue; //a blank line or a comment
+
+        ScriptEvent event;
+        std::string second;
+        std::istringstream tick(first);
+        bool isValid = (tick >> event.tick) && tick.eof() && event.tick >= 0 && (words >> second);
+        if(isValid && second == "undo")
+        {
+            event.isUndo = true;
+        }
+        else if(isValid)
+        {
+            std::istringstream center(second);
+            isValid = (center >> event.center) && center.eof() && (words >> event.pivot)
+                      && event.center >= 0 && event.center < 128 && event.pivot >= 0 && event.pivot < 128;
+        }
+        std::string extra;
+        if(!isValid || (words >> extra))
+        {
+            error = "expected <tick> <center> <pivot> or <tick> undo (line " + std::to_string(lineNum) + ")";
+            return false;
+        }
+        events.push_back(event);
+    }
+    //stable, so events at the same tick happen in the order they are written
+    std::stable_sort(events.begin(), events.end(), [](const ScriptEvent& a, const ScriptEvent& b) { return a.tick < b.tick; });
+    script = std::move(events);
+    return true;
+}
+
+bool BatchRetuner::retune(const juce::MidiFile& input, const Settings& settings, juce::MidiFile& output, std::string& error)
+{
+    RetuneEngine engine;
+    if(!engine.loadScl(settings.sclText))
+    {
+        error = "the .scl couldn't be loaded";
+        return false;
+    }
+    if(!settings.kbmText.empty() && !engine.loadKbm(settings.kbmText))
+    {
+        error = "the .kbm couldn't be loaded";
+        return false;
+    }
+    engine.setOutputMode(settings.outputMode);
+
+    //every channel event goes through the engine as one stream. meta events are copied to their own track
+    juce::MidiMessageSequence events, metaEvents;
+    for(int track = 0; track < input.getNumTracks(); track++)
+    {
+        const juce::MidiMessageSequence* sequence = input.getTrack(track);
+        for(int i = 0; i < sequence->getNumEvents(); i++)
+        {
+            const juce::MidiMessage& message = sequence->getEventPointer(i)->message;
+            if(!message.isMetaEvent()) events.addEvent(message);
+            else if(!message.isEndOfTrackMetaEvent()) metaEvents.addEvent(message);
+        }
+    }
+
+    const short timeFormat = input.getTimeFormat();
+    const double ticksPerSecond = timeFormat > 0 ? timeFormat * 2.0 : 1000.0; //at 120 bpm. only sizes the engine's buffers, since glides are off
+    const int blockSize = juce::jmax(1, settings.blockSize);
+    engine.prepare(ticksPerSecond, blockSize);
+
+    juce::MidiMessageSequence retuned;
+    juce::MidiBuffer buffer;
+    auto getTick = [&events](int index) { return static_cast<juce::int64>(std::llround(events.getEventTime(index))); };
+    size_t nextScriptEvent = 0;
+    int nextEvent = 0;
+    for(juce::int64 blockStart = 0; nextEvent < events.getNumEvents();)
+    {
+        for(; nextScriptEvent < settings.script.size() && settings.script[nextScriptEvent].tick <= blockStart; nextScriptEvent++)
+        {
+            const ScriptEvent& scriptEvent = settings.script[nextScriptEvent];
+            if(scriptEvent.isUndo) engine.undoModulation();
+            else engine.modulate(scriptEvent.center, scriptEvent.pivot);
+        }
+        //a modulation takes effect at the start of a block, so blocks end at the next script event
+        juce::int64 blockEnd = blockStart + blockSize;
+        if(nextScriptEvent < settings.script.size()) blockEnd = juce::jmin(blockEnd, settings.script[nextScriptEvent].tick);
+
+        buffer.clear();
+        for(; nextEvent < events.getNumEvents() && getTick(nextEvent) < blockEnd; nextEvent++)
+        {
+            buffer.addEvent(events.getEventPointer(nextEvent)->message, static_cast<int>(getTick(nextEvent) - blockStart));
+        }
+        engine.process(buffer, static_cast<int>(blockEnd - blockStart));
+        for(const juce::MidiMessageMetadata metadata : buffer)
+        {
+            retuned.addEvent(metadata.getMessage(), static_cast<double>(blockStart + metadata.samplePosition));
+        }
+        blockStart = blockEnd;
+    }
+
+    output.clear();
+    if(timeFormat > 0) output.setTicksPerQuarterNote(timeFormat);
+    else output.setSmpteTimeFormat(-(timeFormat >> 8), timeFormat & 0xff);
+    output.addTrack(metaEvents);
+    output.addTrack(retuned);
+    return true;
+}
+
+BatchRetuner::Result BatchRetuner::retuneFile(const juce::File& input, const juce::File& output, const Settings& settings)
+{
+    Result result;
+    result.input = input;
+    result.output = output;
+
+    juce::FileInputStream inputStream(input);
+    juce::MidiFile inputMidi;
+    if(inputStream.failedToOpen() || !inputMidi.readFrom(inputStream))
+    {
+        result.error = "the file couldn't be read as a Standard MIDI File";
+        return result;
+    }
+    juce::MidiFile outputMidi;
+    if(!retune(inputMidi, settings, outputMidi, result.error)) return result;
+
+    output.getParentDirectory().createDirectory();
+    output.deleteFile();
+    juce::FileOutputStream outputStream(output);
+    if(outputStream.failedToOpen() || !outputMidi.writeTo(outputStream, 1))
+    {
+        result.error = "the output file couldn't be written";
+        return result;
+    }
+    result.isValid = true;
+    return result;
+}
+
+std::vector<BatchRetuner::Result> BatchRetuner::retuneFiles(const std::vector<std::pair<juce::File, juce::File>>& files, const Settings& settings, int numThreads)
+{
+    //each file gets a fresh engine, so no held notes or channel bends carry over from the last file.
+    //the tuning is only parsed and compiled once, since TuningCache shares it between engines.
+    std::vector<Result> results(files.size());
+    if(files.empty()) return results;
+    juce::ThreadPool threadPool(juce::jmax(1, numThreads));
+    std::atomic<size_t> numRemaining(files.size());
+    juce::WaitableEvent finished;
+    for(size_t i = 0; i < files.size(); i++)
+    {
+        threadPool.addJob([&, i]
+        {
+            results[i] = retuneFile(files[i].first, files[i].second, settings);
+            if(--numRemaining == 0) finished.signal();
+        });
+    }
+    finished.wait();
+    return results;
+}
@@ -0,0 +1,86 @@
+/*
+ ==============================================================================
+
+ BatchRetuner.h
+
+ Retunes Standard MIDI Files offline with RetuneEngine, for rendering many stems without a host.
+ Every channel event of a file is merged into one stream and retuned in order, so the output has one track of
+ MPE (or MTS) events, after a track with the input's tempo, time signature, and other meta events.
+ Timestamps stay in ticks: each block passed to RetuneEngine::process() is a span of ticks, so events keep their exact positions.
+
+ A modulation script lists modulations by tick, one per line:
+   <tick> <center> <pivot>   modulates from center to pivot (midi note numbers) at tick
+   <tick> undo               undoes the last modulation at tick
+ Lines starting with '!' or '#' are comments, as in .scl files.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "../../MicroModulationEngine/Source/RetuneEngine.h"
+
+class BatchRetuner
+{
+public:
+    /**
+     One line of a modulation script.
+     */
+    struct ScriptEvent
+    {
+        juce::int64 tick = 0;
+        bool isUndo = false;
+        int center = -1;
+        int pivot = -1;
+    };
+
+    struct Settings
+    {
+        std::string sclText;
+        std::string kbmText;               // empty for the default mapping of the scale
+        std::vector<ScriptEvent> script;   // sorted by tick
+        RetuneEngine::OutputMode outputMode = RetuneEngine::OutputMode::mpe;
+        int blockSize = 960;               // in ticks. Blocks are also split at every script event
+    };
+
+    struct Result
+    {
+        juce::File input;
+        juce::File output;
+        bool isValid = false;
+        std::string error; // why the file couldn't be retuned, if it couldn't
+    };
+
+    /**
+     Parses a modulation script. See the top of this file for the format.
+     @param scriptText The contents of the script.
+     @param script Set to the events of the script, sorted by tick.
+     @param error Set to why the script isn't valid, if it isn't.
+     @return false if any line couldn't be parsed.
+     */
+    static bool parseScript(std::string_view scriptText, std::vector<ScriptEvent>& script, std::string& error);
+
+    /**
+     Retunes every channel event of input.
+     @param output Replaced by the retuned file, with the same time format as input.
+     @param error Set to why the file couldn't be retuned, if it couldn't.
+     @return false if the tuning couldn't be loaded.
+     */
+    static bool retune(const juce::MidiFile& input, const Settings& settings, juce::MidiFile& output, std::string& error);
+    /**
+     Reads input, retunes it, and writes it to output.
+     */
+    static Result retuneFile(const juce::File& input, const juce::File& output, const Settings& settings);
+    /**
+     Retunes many files in parallel. Each file gets its own RetuneEngine on one of numThreads worker threads.
+     @param files Pairs of input and output files.
+     @return The result of each pair, in the same order.
+     */
+    static std::vector<Result> retuneFiles(const std::vector<std::pair<juce::File, juce::File>>& files, const Settings& settings, int numThreads);
+};
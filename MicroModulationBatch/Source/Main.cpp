@@ -0,0 +1,121 @@
+/*
+ ==============================================================================
+
+ Main.cpp
+
+ MicroModulationBatch: retunes Standard MIDI Files from the command line. See BatchRetuner.h and printUsage().
+
+ ==============================================================================
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "JuceHeader.h"
+
+#include "BatchRetuner.h"
+#include "../../MicroModulation/Source/ScalaParser.h"
+
+static void printUsage()
+{
+    std::cout << "Usage: MicroModulationBatch --scl=<file> --out=<directory> [options] <.mid file or directory>...\n"
+                 "  --scl=<file>       the scale to retune to\n"
+                 "  --kbm=<file>       a keyboard map for the scale. The default maps one note per key, from middle C\n"
+                 "  --script=<file>    modulations to make while retuning. See BatchRetuner.h for the format\n"
+                 "  --out=<directory>  where to write the retuned files. Files from a directory keep their relative paths\n"
+                 "  --threads=<n>      the number of files to retune at once. Defaults to the number of cores\n"
+                 "  --mts              retune with MIDI Tuning Standard SysEx instead of MPE\n";
+}
+
+/**
+ Reads the file named by an option into text.
+ @return false if the option is missing (and required) or the file couldn't be read.
+ */
+static bool readOptionFile(const juce::ArgumentList& args, const juce::String& option, bool isRequired, std::string& text)
+{
+    juce::String path = args.getValueForOption(option);
+    if(path.isEmpty())
+    {
+        if(isRequired) std::cerr << "Missing " << option << "\n";
+        return !isRequired;
+    }
+    juce::File file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+    if(!scala::readFile(file.getFullPathName().toStdString(), text))
+    {
+        std::cerr << "Couldn't read " << file.getFullPathName() << "\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    if(args.size() == 0 || args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return args.size() == 0 ? 1 : 0;
+    }
+
+    BatchRetuner::Settings settings;
+    std::string scriptText;
+    if(!readOptionFile(args, "--scl", true, settings.sclText)
+       || !readOptionFile(args, "--kbm", false, settings.kbmText)
+       || !readOptionFile(args, "--script", false, scriptText))
+    {
+        return 1;
+    }
+    std::string error;
+    if(!BatchRetuner::parseScript(scriptText, settings.script, error))
+    {
+        std::cerr << "Couldn't parse the script: " << error << "\n";
+        return 1;
+    }
+    if(args.containsOption("--mts")) settings.outputMode = RetuneEngine::OutputMode::mts;
+
+    juce::String outPath = args.getValueForOption("--out");
+    if(outPath.isEmpty())
+    {
+        std::cerr << "Missing --out\n";
+        return 1;
+    }
+    juce::File outDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(outPath);
+
+    std::vector<std::pair<juce::File, juce::File>> files;
+    for(const juce::ArgumentList::Argument& arg : args.arguments)
+    {
+        if(arg.isOption()) continue;
+        juce::File input = arg.resolveAsFile();
+        if(input.isDirectory())
+        {
+            for(const juce::File& file : input.findChildFiles(juce::File::findFiles, true, "*.mid;*.midi"))
+            {
+                files.emplace_back(file, outDirectory.getChildFile(file.getRelativePathFrom(input)));
+            }
+        }
+        else if(input.existsAsFile())
+        {
+            files.emplace_back(input, outDirectory.getChildFile(input.getFileName()));
+        }
+        else
+        {
+            std::cerr << "Couldn't find " << input.getFullPathName() << "\n";
+            return 1;
+        }
+    }
+
+    int numThreads = args.getValueForOption("--threads").getIntValue();
+    if(numThreads <= 0) numThreads = juce::SystemStats::getNumCpus();
+    std::vector<BatchRetuner::Result> results = BatchRetuner::retuneFiles(files, settings, numThreads);
+
+    int numFailed = 0;
+    for(const BatchRetuner::Result& result : results)
+    {
+        if(result.isValid) continue;
+        std::cerr << result.input.getFullPathName() << ": " << result.error << "\n";
+        numFailed++;
+    }
+    std::cout << "Retuned " << (results.size() - static_cast<size_t>(numFailed)) << " of " << results.size() << " files\n";
+    return numFailed == 0 ? 0 : 1;
+}
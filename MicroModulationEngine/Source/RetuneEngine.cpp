@@ -0,0 +1,79 @@
+/*
+ ==============================================================================
+
+ RetuneEngine.cpp
+
+ ==============================================================================
+ */
+
+#include <limits>
+
+#include "JuceHeader.h"
+
+#include "RetuneEngine.h"
+#include "../../MicroModulation/Source/MidiProcessor.h"
+
+struct RetuneEngine::Impl
+{
+    juce::UndoManager undoManager; // MidiProcessor needs one, but the engine only undoes through the modulation history
+    MidiProcessor processor { undoManager };
+};
+
+RetuneEngine::RetuneEngine() : impl(std::make_unique<Impl>()) {}
+RetuneEngine::~RetuneEngine() = default;
+RetuneEngine::RetuneEngine(RetuneEngine&&) noexcept = default;
+RetuneEngine& RetuneEngine::operator=(RetuneEngine&&) noexcept = default;
+
+bool RetuneEngine::loadScl(std::string_view sclText) { return impl->processor.loadSclString(sclText); }
+bool RetuneEngine::loadKbm(std::string_view kbmText) { return impl->processor.loadKbmString(kbmText); }
+bool RetuneEngine::loadSclFile(const std::string& path)
+{
+    return impl->processor.loadSclFile(juce::File::getCurrentWorkingDirectory().getChildFile(path)); //so relative paths work too
+}
+bool RetuneEngine::loadKbmFile(const std::string& path)
+{
+    return impl->processor.loadKbmFile(juce::File::getCurrentWorkingDirectory().getChildFile(path));
+}
+
+double RetuneEngine::getPitch(int midiNote) const
+{
+    if(midiNote < 0 || midiNote > 127) return std::numeric_limits<double>::quiet_NaN();
+    return impl->processor.getScale().getPitch(static_cast<juce::int8>(midiNote));
+}
+
+bool RetuneEngine::modulate(int center, int pivot)
+{
+    MidiProcessor& processor = impl->processor;
+    juce::int64 position = processor.getModulationHistory().getPosition();
+    processor.setCenter(center);
+    processor.setPivot(pivot);
+    processor.modulate();
+    return processor.getModulationHistory().getPosition() != position;
+}
+
+bool RetuneEngine::undoModulation()
+{
+    MidiProcessor& processor = impl->processor;
+    processor.publishStreamModulations();
+    if(!processor.getModulationHistory().canUndo()) return false;
+    processor.undo();
+    return true;
+}
+
+double RetuneEngine::getModulationOffset() const
+{
+    impl->processor.publishStreamModulations();
+    return impl->processor.getScale().getModulationOffset();
+}
+
+void RetuneEngine::setModulationKeyRange(int lowestKey, int highestKey) { impl->processor.setModulationKeyRange(lowestKey, highestKey); }
+void RetuneEngine::setProgramChangeResetsModulation(bool shouldReset) { impl->processor.setProgramChangeResetsModulation(shouldReset); }
+
+void RetuneEngine::setOutputMode(OutputMode newMode)
+{
+    impl->processor.setOutputMode(newMode == OutputMode::mts ? MidiProcessor::OutputMode::mts : MidiProcessor::OutputMode::mpe);
+}
+void RetuneEngine::setRetuneHeldNotes(bool shouldRetune) { impl->processor.setRetuneHeldNotes(shouldRetune); }
+
+void RetuneEngine::prepare(double sampleRate, int maxBlockSize) { impl->processor.prepareToPlay(sampleRate, maxBlockSize); }
+void RetuneEngine::process(juce::MidiBuffer& midiMessages, int numSamples) { impl->processor.process(midiMessages, numSamples); }
@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+
+ RetuneEngine.h
+
+ The public API of the MicroModulationEngine static library: compile a tuning from .scl and .kbm text, modulate it,
+ and retune blocks of midi events, without a plugin host or any GUI modules.
+ This header only uses the standard library, and forward declares juce::MidiBuffer, so programs that embed the engine
+ only need juce_audio_basics (for juce::MidiBuffer) to call it. The engine itself is built with juce_core, juce_events,
+ juce_data_structures, and juce_audio_basics.
+
+ Everything except process() should be called from one control thread. process() can run at the same time on
+ a realtime thread, and doesn't lock or allocate once prepare() has been called. A program that processes offline
+ can call everything from one thread.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace juce { class MidiBuffer; }
+
+class RetuneEngine
+{
+public:
+    /**
+     Incremented whenever a function of this class is changed or removed.
+     */
+    static constexpr int apiVersion = 1;
+
+    enum class OutputMode
+    {
+        mpe, // notes are spread across MPE member channels, and bent with pitch wheel messages
+        mts  // notes pass through unchanged, and the synth is retuned with MIDI Tuning Standard SysEx
+    };
+
+    RetuneEngine();
+    ~RetuneEngine();
+    RetuneEngine(RetuneEngine&&) noexcept;
+    RetuneEngine& operator=(RetuneEngine&&) noexcept;
+
+    // ==============================================================================
+    // Compiling a tuning
+    // ==============================================================================
+    /**
+     Parses and compiles a .scl file stored in a string. The keyboard map is reset to the default mapping of the new scale.
+     @return false if the text isn't a valid .scl file. The tuning is then left unchanged.
+     */
+    bool loadScl(std::string_view sclText);
+    /**
+     Parses and compiles a .kbm file stored in a string, for the scale that is loaded.
+     @return false if the text isn't a valid .kbm file, or doesn't fit the scale. The tuning is then left unchanged.
+     */
+    bool loadKbm(std::string_view kbmText);
+    /**
+     Reads and loads a .scl file. Relative paths are from the current working directory.
+     */
+    bool loadSclFile(const std::string& path);
+    bool loadKbmFile(const std::string& path);
+    /**
+     @return The pitch midiNote is retuned to, including modulations, as a fractional midi note number (69.0 is A440).
+     NaN if the note isn't mapped.
+     */
+    double getPitch(int midiNote) const;
+
+    // ==============================================================================
+    // Modulating
+    // ==============================================================================
+    /**
+     Modulates from center to pivot: the tuning around pivot becomes the tuning that was around center.
+     Takes effect at the start of the next call to process().
+     @return false if either note isn't mapped (or they are the same note), so nothing changed.
+     */
+    bool modulate(int center, int pivot);
+    /**
+     Undoes the last modulation. Takes effect at the start of the next call to process().
+     @return false if there was nothing to undo.
+     */
+    bool undoModulation();
+    /**
+     @return The semitones that modulations have added to every pitch since the tuning was loaded.
+     */
+    double getModulationOffset() const;
+    /**
+     Reserves a range of keys for triggering modulations from the midi stream. Holding one reserved key and pressing
+     another modulates from the held key to the pressed key, at the pressed key's timestamp. Reserved keys aren't played.
+     @param lowestKey The lowest reserved key, or -1 to not reserve any keys.
+     */
+    void setModulationKeyRange(int lowestKey, int highestKey);
+    /**
+     @param shouldReset If true, program changes in the midi stream return to the unmodulated tuning.
+     */
+    void setProgramChangeResetsModulation(bool shouldReset);
+
+    // ==============================================================================
+    // Processing
+    // ==============================================================================
+    void setOutputMode(OutputMode newMode);
+    /**
+     @param shouldRetune If true, notes that are held through a modulation are bent to the new tuning.
+     */
+    void setRetuneHeldNotes(bool shouldRetune);
+    /**
+     Preallocates everything process() needs. Call this before processing, and whenever the block size changes.
+     @param sampleRate The sample rate that event timestamps are counted in.
+     @param maxBlockSize The largest numSamples that will be passed to process().
+     */
+    void prepare(double sampleRate, int maxBlockSize);
+    /**
+     Retunes a block of midi events in place.
+     @param midiMessages The events of the block, timestamped in samples from its start. Replaced by the retuned events.
+     @param numSamples The length of the block.
+     */
+    void process(juce::MidiBuffer& midiMessages, int numSamples);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
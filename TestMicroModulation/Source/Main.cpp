@@ -1,13 +1,24 @@
-#define CATCH_CONFIG_MAIN
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-
-//catch2 unit testing
-#include "Catch/catch_amalgamated.hpp"
-
-//Unit-tests
-#include "TestScale.h"
-#include "TestKeyboardMap.h"
-//#include "TestModulate.h"
+#define CATCH_CONFIG_MAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//catch2 unit testing
+#include "Catch/catch_amalgamated.hpp"
+
+//Unit-tests
+#include "TestScale.h"
+#include "TestKeyboardMap.h"
+#include "TestScalaParser.h"
+#include "TestScaleLibrary.h"
+#include "TestScalePack.h"
+#include "TestRetuneTable.h"
+#include "TestTuningCache.h"
+#include "TestMidiProcessor.h"
+#include "TestPluginState.h"
+#include "TestModulationHistory.h"
+#include "TestRetuneEngine.h"
+#include "TestBatchRetuner.h"
+#include "TestUniversalMidiPackets.h"
+//#include "TestModulate.h"
@@ -0,0 +1,150 @@
+/*
+ ==============================================================================
+
+ TestBatchRetuner.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulationBatch/Source/BatchRetuner.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("Modulation scripts are parsed into events sorted by tick")
+{
+    std::vector<BatchRetuner::ScriptEvent> script;
+    std::string error;
+
+    SECTION("Valid scripts")
+    {
+        REQUIRE(BatchRetuner::parseScript("! a comment\n1920 undo\n\n960 60 62\r\n# another comment\n960 62 67\n", script, error));
+        REQUIRE(script.size() == 3);
+        REQUIRE(script[0].tick == 960);
+        REQUIRE(script[0].center == 60);
+        REQUIRE(script[0].pivot == 62);
+        REQUIRE(script[1].center == 62); //events at the same tick stay in the order they were written
+        REQUIRE(script[2].tick == 1920);
+        REQUIRE(script[2].isUndo);
+    }
+    SECTION("Invalid scripts")
+    {
+        REQUIRE_FALSE(BatchRetuner::parseScript("960 60\n", script, error));
+        REQUIRE(error.find("line 1") != std::string::npos);
+        REQUIRE_FALSE(BatchRetuner::parseScript("0 60 62\n-5 60 62\n", script, error));
+        REQUIRE_FALSE(BatchRetuner::parseScript("0 60 128\n", script, error));
+        REQUIRE_FALSE(BatchRetuner::parseScript("0 60 62 64\n", script, error));
+        REQUIRE_FALSE(BatchRetuner::parseScript("1.5 60 62\n", script, error));
+        REQUIRE(script.empty()); //nothing is changed by a failed parse
+    }
+}
+
+TEST_CASE("BatchRetuner retunes a MIDI file, modulating where the script says")
+{
+    juce::MidiMessageSequence tempoTrack, noteTrack;
+    tempoTrack.addEvent(juce::MidiMessage::tempoMetaEvent(500000), 0.0);
+    noteTrack.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0.0);
+    noteTrack.addEvent(juce::MidiMessage::noteOff(1, 60), 480.0);
+    noteTrack.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 960.0);
+    noteTrack.addEvent(juce::MidiMessage::noteOff(1, 64), 1440.0);
+    juce::MidiFile input;
+    input.setTicksPerQuarterNote(480);
+    input.addTrack(tempoTrack);
+    input.addTrack(noteTrack);
+
+    BatchRetuner::Settings settings;
+    settings.sclText = utils::makeSclString("12-TET 12 notes", "12", {"100.0", "200.0", "300.0", "400.0", "500.0", "600.0", "700.0", "800.0", "900.0", "1000.0", "1100.0", "1200.0"});
+    std::string error;
+    REQUIRE(BatchRetuner::parseScript("960 60 62\n", settings.script, error));
+
+    juce::MidiFile output;
+    REQUIRE(BatchRetuner::retune(input, settings, output, error));
+    REQUIRE(output.getTimeFormat() == 480);
+    REQUIRE(output.getNumTracks() == 2);
+    REQUIRE(output.getTrack(0)->getNumEvents() == 1); //the tempo
+    REQUIRE(output.getTrack(0)->getEventPointer(0)->message.isTempoMetaEvent());
+
+    std::vector<std::pair<double, int>> noteOns; // the tick and note number of each note on
+    const juce::MidiMessageSequence* retuned = output.getTrack(1);
+    for(int i = 0; i < retuned->getNumEvents(); i++)
+    {
+        const juce::MidiMessage& message = retuned->getEventPointer(i)->message;
+        if(message.isNoteOn()) noteOns.push_back({message.getTimeStamp(), message.getNoteNumber()});
+    }
+    REQUIRE(noteOns.size() == 2);
+    REQUIRE(noteOns[0] == std::pair<double, int>{0.0, 60});
+    REQUIRE(noteOns[1] == std::pair<double, int>{960.0, 66}); //a whole tone higher after the modulation
+
+    SECTION("A scale that can't be loaded is reported")
+    {
+        settings.sclText = "not a scale";
+        REQUIRE_FALSE(BatchRetuner::retune(input, settings, output, error));
+        REQUIRE_FALSE(error.empty());
+    }
+}
+
+TEST_CASE("BatchRetuner retunes many files on several threads")
+{
+    juce::File directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("TestBatchRetuner");
+    directory.deleteRecursively();
+    REQUIRE(directory.createDirectory());
+
+    std::vector<std::pair<juce::File, juce::File>> files;
+    const int numMidiFiles = 6;
+    for(int i = 0; i < numMidiFiles; i++)
+    {
+        juce::MidiMessageSequence noteTrack;
+        noteTrack.addEvent(juce::MidiMessage::noteOn(1, 60 + i, (juce::uint8) 100), 0.0);
+        noteTrack.addEvent(juce::MidiMessage::noteOff(1, 60 + i), 480.0);
+        juce::MidiFile midiFile;
+        midiFile.setTicksPerQuarterNote(480);
+        midiFile.addTrack(noteTrack);
+        juce::File input = directory.getChildFile("stem" + juce::String(i) + ".mid");
+        juce::FileOutputStream stream(input);
+        REQUIRE(midiFile.writeTo(stream, 1));
+        files.push_back({input, directory.getChildFile("retuned").getChildFile("stem" + juce::String(i) + ".mid")});
+    }
+    juce::File notMidi = directory.getChildFile("notes.txt");
+    REQUIRE(notMidi.replaceWithText("not a MIDI file"));
+    files.push_back({notMidi, directory.getChildFile("retuned").getChildFile("notes.mid")});
+
+    BatchRetuner::Settings settings;
+    settings.sclText = utils::makeSclString("12-TET 12 notes", "12", {"100.0", "200.0", "300.0", "400.0", "500.0", "600.0", "700.0", "800.0", "900.0", "1000.0", "1100.0", "1200.0"});
+    std::vector<BatchRetuner::Result> results = BatchRetuner::retuneFiles(files, settings, 3);
+
+    REQUIRE(results.size() == files.size());
+    for(int i = 0; i < numMidiFiles; i++)
+    {
+        INFO("file " << i);
+        REQUIRE(results[i].input == files[i].first);
+        REQUIRE(results[i].output == files[i].second);
+        REQUIRE(results[i].isValid);
+        REQUIRE(results[i].error.empty());
+
+        juce::FileInputStream stream(files[i].second);
+        juce::MidiFile output;
+        REQUIRE(output.readFrom(stream));
+        std::vector<int> noteOns;
+        for(int track = 0; track < output.getNumTracks(); track++)
+        {
+            const juce::MidiMessageSequence* sequence = output.getTrack(track);
+            for(int event = 0; event < sequence->getNumEvents(); event++)
+            {
+                const juce::MidiMessage& message = sequence->getEventPointer(event)->message;
+                if(message.isNoteOn()) noteOns.push_back(message.getNoteNumber());
+            }
+        }
+        REQUIRE(noteOns == std::vector<int>{60 + i}); //each output has its own input's note, not another file's
+    }
+    const BatchRetuner::Result& invalid = results.back();
+    REQUIRE(invalid.input == notMidi);
+    REQUIRE_FALSE(invalid.isValid);
+    REQUIRE(invalid.error == "the file couldn't be read as a Standard MIDI File");
+    REQUIRE_FALSE(invalid.output.exists());
+
+    directory.deleteRecursively();
+}
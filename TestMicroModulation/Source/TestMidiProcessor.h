@@ -0,0 +1,899 @@
+/*
+ ==============================================================================
+ 
+ TestMidiProcessor.h
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <set>
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/MidiProcessor.h"
+#include "../../MicroModulation/Source/utils.h"
+
+/**
+ Counts the note on messages in buffer that have noteNumber.
+ */
+static int countNoteOns(const juce::MidiBuffer& buffer, int noteNumber)
+{
+    int count = 0;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        auto message = metadata.getMessage();
+        if(message.isNoteOn() && message.getNoteNumber() == noteNumber) count++;
+    }
+    return count;
+}
+
+/**
+ @param channelBends The pitch wheel of each channel before buffer. Updated with the pitch wheel messages in buffer.
+ @return The pitch wheel of the channel each note on in buffer was played on, in order.
+ */
+static std::vector<int> getNoteOnPitchWheels(const juce::MidiBuffer& buffer, int* channelBends)
+{
+    std::vector<int> pitchWheels;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        auto message = metadata.getMessage();
+        if(message.isPitchWheel()) channelBends[message.getChannel()] = message.getPitchWheelValue();
+        if(message.isNoteOn()) pitchWheels.push_back(channelBends[message.getChannel()]);
+    }
+    return pitchWheels;
+}
+
+TEST_CASE("MidiProcessor hands new tunings to the audio thread")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    juce::MidiBuffer buffer;
+    
+    SECTION("Nothing is retuned until a tuning is published")
+    {
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+        m.process(buffer);
+        REQUIRE(buffer.getNumEvents() == 0);
+    }
+    SECTION("A published tuning is used from the next block")
+    {
+        REQUIRE(m.loadSclString(utils::makeSclString("12-TET 12 notes", "12", {"100.0", "200.0", "300.0", "400.0", "500.0", "600.0", "700.0", "800.0", "900.0", "1000.0", "1100.0", "1200.0"})));
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+        m.process(buffer);
+        REQUIRE(countNoteOns(buffer, 60) == 1);
+    }
+    SECTION("Publishing many tunings between blocks only keeps the newest")
+    {
+        for(int i = 0; i < 100; i++)
+        {
+            REQUIRE(m.loadSclString(utils::makeSclString("1 note", "1", {std::string(i % 2 == 0 ? "200.0" : "150.0")})));
+        }
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+        m.process(buffer);
+        // with 150 cents per key, 60 is 9 keys below A440
+        const RetuneTable::Entry newest = RetuneTable::makeEntryFromPitch(60, 69.0 - 9 * 1.5, 1.0f);
+        int channelBends[17];
+        std::fill(std::begin(channelBends), std::end(channelBends), 8192);
+        std::vector<int> pitchWheels = getNoteOnPitchWheels(buffer, channelBends);
+        REQUIRE(countNoteOns(buffer, newest.noteNumber) == 1);
+        REQUIRE(pitchWheels.size() == 1);
+        REQUIRE(pitchWheels[0] == Catch::Approx(newest.pitchWheel).margin(2));
+    }
+    SECTION("Retired snapshots are released outside of process()")
+    {
+        juce::MidiBuffer empty;
+        REQUIRE(m.loadSclString(utils::makeSclString("1 note", "1", {"100.0"})));
+        m.process(empty);
+        m.releaseRetiredSnapshots();
+        const int numSnapshots = TuningSnapshot::getNumSnapshots(); // counts m's active snapshot
+        for(int i = 0; i < 100; i++)
+        {
+            REQUIRE(m.loadSclString(utils::makeSclString("1 note", "1", {"100.0"})));
+            m.process(empty);
+        }
+        REQUIRE(TuningSnapshot::getNumSnapshots() == numSnapshots + 1); // the snapshot the last block replaced is still retired
+        m.releaseRetiredSnapshots(); // what PluginProcessor's timer does
+        REQUIRE(TuningSnapshot::getNumSnapshots() == numSnapshots);
+        
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+        m.process(buffer);
+        REQUIRE(countNoteOns(buffer, 60) == 1);
+    }
+}
+
+TEST_CASE("The last note played is stored without touching the ValueTree on the audio thread")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    REQUIRE(m.loadSclString(utils::makeSclString("12-TET 1 note", "1", {"100.0"})));
+    juce::MidiBuffer buffer;
+    
+    REQUIRE(m.getLastNotePlayed() == -1);
+    
+    int numUndoActions = um.getNumActionsInCurrentTransaction();
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 0);
+    m.process(buffer);
+    
+    REQUIRE(m.getLastNotePlayed() == 64);
+    REQUIRE(static_cast<int>(m.midiProcessorValues.getProperty(IDs::lastNotePlayed)) == -1);
+    REQUIRE(um.getNumActionsInCurrentTransaction() == numUndoActions);
+    
+    m.publishLastNotePlayed();
+    REQUIRE(static_cast<int>(m.midiProcessorValues.getProperty(IDs::lastNotePlayed)) == 64);
+    REQUIRE(um.getNumActionsInCurrentTransaction() == numUndoActions);
+}
+
+TEST_CASE("ChannelAllocator assigns MPE member channels")
+{
+    ChannelAllocator allocator(2, 16);
+    
+    SECTION("Notes with different bends are spread round-robin over free channels")
+    {
+        for(int i = 0; i < 15; i++)
+        {
+            auto assignment = allocator.findChannelForNewNote(60 + i, 8192 + i);
+            REQUIRE(assignment.channel == 2 + i);
+            REQUIRE(assignment.pitchWheelChanged);
+        }
+    }
+    SECTION("Notes with the same bend share a channel")
+    {
+        auto first = allocator.findChannelForNewNote(60, 9000);
+        auto second = allocator.findChannelForNewNote(64, 9000);
+        REQUIRE(first.channel == second.channel);
+        REQUIRE(first.pitchWheelChanged);
+        REQUIRE_FALSE(second.pitchWheelChanged);
+        REQUIRE(allocator.getNumNotes(first.channel) == 2);
+    }
+    SECTION("The same note number isn't played twice on one channel")
+    {
+        auto first = allocator.findChannelForNewNote(60, 9000);
+        auto second = allocator.findChannelForNewNote(60, 9000);
+        REQUIRE(first.channel != second.channel);
+    }
+    SECTION("A free channel that is already bent correctly is reused")
+    {
+        auto first = allocator.findChannelForNewNote(60, 9000);
+        allocator.findChannelForNewNote(62, 7000);
+        allocator.noteOff(first.channel, 60);
+        auto again = allocator.findChannelForNewNote(67, 9000);
+        REQUIRE(again.channel == first.channel);
+        REQUIRE_FALSE(again.pitchWheelChanged);
+    }
+    SECTION("Tunings with few bend classes aren't limited to 15 voices")
+    {
+        // 24-EDO only needs two bends.
+        for(int note = 0; note < 128; note++) allocator.findChannelForNewNote(note, 8192);
+        for(int note = 0; note < 128; note++) allocator.findChannelForNewNote(note, 10240);
+        int numChannelsUsed = 0;
+        for(int ch = 2; ch <= 16; ch++)
+        {
+            if(allocator.getNumNotes(ch) > 0) numChannelsUsed++;
+        }
+        REQUIRE(numChannelsUsed == 2);
+    }
+    SECTION("Without pooling, notes only share a channel when every channel is busy")
+    {
+        allocator.setPoolByBend(false);
+        for(int i = 0; i < 15; i++) allocator.findChannelForNewNote(40 + i, 9000);
+        for(int ch = 2; ch <= 16; ch++) REQUIRE(allocator.getNumNotes(ch) == 1);
+        allocator.findChannelForNewNote(80, 9000);
+        for(int ch = 2; ch <= 16; ch++)
+        {
+            REQUIRE(allocator.getNumNotes(ch) >= 1);
+            REQUIRE(allocator.getNumNotes(ch) <= 2);
+        }
+    }
+    SECTION("A channel stolen for another bend releases its notes, oldest channel first")
+    {
+        for(int i = 0; i < 15; i++) allocator.findChannelForNewNote(60 + i, 8192 + i);
+        allocator.noteOff(2, 60);
+        REQUIRE(allocator.findChannelForNewNote(60, 8192).channel == 2); // so channel 3 has gone longest without a new note
+        auto stolen = allocator.findChannelForNewNote(76, 9000);
+        REQUIRE(stolen.channel == 3);
+        REQUIRE(stolen.notesReleased);
+        REQUIRE(stolen.pitchWheelChanged);
+        REQUIRE(allocator.getNumNotes(3) == 1);
+
+        auto sameBend = allocator.findChannelForNewNote(77, 9000); // joins the stolen channel, since it has the right bend now
+        REQUIRE(sameBend.channel == 3);
+        REQUIRE_FALSE(sameBend.notesReleased);
+    }
+}
+
+TEST_CASE("MidiProcessor sends note offs for the notes on a stolen channel before bending it")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    // every step of 17-EDO is a different distance from the nearest semitone, so each key needs its own bend
+    std::vector<std::string> steps;
+    for(int step = 1; step <= 17; step++) steps.push_back(std::to_string(step * 1200.0 / 17.0));
+    REQUIRE(m.loadSclString(utils::makeSclString("17-EDO", "17", steps)));
+    juce::MidiBuffer buffer;
+    for(int i = 0; i < 15; i++) buffer.addEvent(juce::MidiMessage::noteOn(1, 60 + i, (juce::uint8) 100), i);
+    m.process(buffer);
+    int oldestChannel = -1, oldestNote = -1;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        auto message = metadata.getMessage();
+        if(!message.isNoteOn()) continue;
+        oldestChannel = message.getChannel();
+        oldestNote = message.getNoteNumber();
+        break;
+    }
+    REQUIRE(oldestChannel != -1);
+
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 75, (juce::uint8) 100), 0);
+    m.process(buffer);
+    std::vector<juce::MidiMessage> messages;
+    for(const juce::MidiMessageMetadata metadata : buffer) messages.push_back(metadata.getMessage());
+    REQUIRE(messages.size() == 3);
+    REQUIRE(messages[0].isNoteOff());
+    REQUIRE(messages[0].getChannel() == oldestChannel);
+    REQUIRE(messages[0].getNoteNumber() == oldestNote);
+    REQUIRE(messages[1].isPitchWheel());
+    REQUIRE(messages[1].getChannel() == oldestChannel);
+    REQUIRE(messages[2].isNoteOn());
+    REQUIRE(messages[2].getChannel() == oldestChannel);
+
+    buffer.clear();
+    buffer.addEvent(juce::MidiMessage::noteOff(1, 60), 0); // already released when its channel was stolen
+    m.process(buffer);
+    REQUIRE(buffer.getNumEvents() == 0);
+}
+
+/**
+ Counts the sysex messages in buffer that start with header.
+ */
+static int countSysex(const juce::MidiBuffer& buffer, std::initializer_list<juce::uint8> header, int* sizeOfLast = nullptr)
+{
+    int count = 0;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        if(metadata.numBytes < static_cast<int>(header.size())
+           || !std::equal(header.begin(), header.end(), metadata.data)) continue;
+        count++;
+        if(sizeOfLast != nullptr) *sizeOfLast = metadata.numBytes;
+    }
+    return count;
+}
+
+#if MICROMOD_CHECK_ALLOCATIONS
+TEST_CASE("MidiProcessor::process() doesn't allocate after prepareToPlay()")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    REQUIRE(m.loadSclString(utils::makeSclString("12-TET 1 note", "1", {"100.0"})));
+    
+    int samplesPerBlock = 32;
+    m.prepareToPlay(44100.0, samplesPerBlock);
+    
+    juce::MidiBuffer buffer; // the host owns this buffer, and doesn't size it for the output
+    int allocationsBefore = allocation_checker::getNumAllocations();
+    m.setOutputMode(MidiProcessor::OutputMode::mts);
+    {
+        allocation_checker::ScopedNoAllocations noAllocations;
+        m.process(buffer); // a bulk tuning dump, from an empty input
+    }
+    REQUIRE(countSysex(buffer, {0xf0, 0x7e, 0x7f, 0x08, 0x01}) == 1);
+    m.setOutputMode(MidiProcessor::OutputMode::mpe);
+    for(int block = 0; block < 100; block++)
+    {
+        buffer.clear();
+        for(int i = 0; i < samplesPerBlock; i++)
+        {
+            int note = 40 + (block + i) % 48;
+            if(i % 2 == 0) buffer.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8) 100), i);
+            else buffer.addEvent(juce::MidiMessage::noteOff(1, note), i);
+        }
+        
+        allocation_checker::ScopedNoAllocations noAllocations;
+        m.process(buffer);
+    }
+    REQUIRE(allocation_checker::getNumAllocations() == allocationsBefore);
+}
+
+TEST_CASE("MidiProcessor::process() doesn't allocate when the host alternates between its own buffers")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    REQUIRE(m.loadSclString(utils::makeSclString("12-TET 1 note", "1", {"100.0"})));
+    int samplesPerBlock = 32;
+    m.prepareToPlay(44100.0, samplesPerBlock);
+
+    juce::MidiBuffer hostBuffers[2]; // neither is sized for the output
+    std::set<const juce::uint8*> storages;
+    int allocationsBefore = allocation_checker::getNumAllocations();
+    for(int block = 0; block < 100; block++)
+    {
+        juce::MidiBuffer& buffer = hostBuffers[block % 2];
+        buffer.clear();
+        for(int i = 0; i < samplesPerBlock; i++)
+        {
+            int note = 40 + (block + i) % 48;
+            if(i % 2 == 0) buffer.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8) 100), i);
+            else buffer.addEvent(juce::MidiMessage::noteOff(1, note), i);
+        }
+        {
+            allocation_checker::ScopedNoAllocations noAllocations;
+            m.process(buffer);
+        }
+        REQUIRE(countNoteOns(buffer, 40 + (block % 48)) == 1);
+        storages.insert(buffer.data.begin());
+    }
+    REQUIRE(allocation_checker::getNumAllocations() == allocationsBefore);
+    REQUIRE(storages.size() <= 3); // the host's buffers only ever hold the storage that prepareToPlay() allocated, so none of it grew
+}
+#endif
+
+/**
+ Counts the pitch wheel messages in buffer.
+ */
+static int countPitchWheels(const juce::MidiBuffer& buffer)
+{
+    int count = 0;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        if(metadata.getMessage().isPitchWheel()) count++;
+    }
+    return count;
+}
+
+TEST_CASE("A static channel layout sends each bend once")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.setUseStaticChannelLayout(true);
+    juce::MidiBuffer buffer;
+    
+    SECTION("24-EDO has two bend classes")
+    {
+        REQUIRE(m.loadSclString(utils::makeSclString("24-EDO", "1", {"50.0"})));
+        m.process(buffer);
+        REQUIRE(countPitchWheels(buffer) == 2);
+        
+        for(int block = 0; block < 10; block++)
+        {
+            buffer.clear();
+            for(int i = 0; i < 8; i++) buffer.addEvent(juce::MidiMessage::noteOn(1, 50 + block + i, (juce::uint8) 100), i);
+            m.process(buffer);
+            REQUIRE(countPitchWheels(buffer) == 0);
+            
+            buffer.clear();
+            for(int i = 0; i < 8; i++) buffer.addEvent(juce::MidiMessage::noteOff(1, 50 + block + i), i);
+            m.process(buffer);
+        }
+    }
+    SECTION("Notes of the same bend class are played on the same channel")
+    {
+        REQUIRE(m.loadSclString(utils::makeSclString("24-EDO", "1", {"50.0"})));
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 62, (juce::uint8) 100), 0);
+        m.process(buffer);
+        
+        juce::Array<int> channels;
+        for(const juce::MidiMessageMetadata metadata : buffer)
+        {
+            if(metadata.getMessage().isNoteOn()) channels.add(metadata.getMessage().getChannel());
+        }
+        REQUIRE(channels.size() == 2);
+        REQUIRE(channels[0] == channels[1]);
+    }
+    SECTION("Tunings with too many bend classes fall back to per-note pitchbend")
+    {
+        std::vector<std::string> notes;
+        for(int i = 1; i <= 17; i++) notes.push_back(std::to_string(i * 70.1));
+        REQUIRE(m.loadSclString(utils::makeSclString("Many bends", "17", notes)));
+        m.process(buffer);
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+        m.process(buffer);
+        REQUIRE(countPitchWheels(buffer) == 1);
+    }
+}
+
+TEST_CASE("MTS output mode retunes with SysEx instead of pitchbend")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.setOutputMode(MidiProcessor::OutputMode::mts);
+    juce::MidiBuffer buffer;
+    REQUIRE(m.loadSclString(utils::makeSclString("Just major", "7", {"9/8", "5/4", "4/3", "3/2", "5/3", "15/8", "2/1"})));
+    
+    SECTION("Loading a tuning sends a bulk tuning dump")
+    {
+        m.process(buffer);
+        int size = 0;
+        REQUIRE(countSysex(buffer, {0xf0, 0x7e, 0x7f, 0x08, 0x01}, &size) == 1);
+        REQUIRE(size == mts::bulkDumpSize);
+        REQUIRE(size == 408);
+    }
+    SECTION("Notes pass through on their own channel and note number")
+    {
+        m.process(buffer);
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::noteOn(3, 64, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::noteOff(3, 64), 10);
+        m.process(buffer);
+        
+        REQUIRE(countPitchWheels(buffer) == 0);
+        int numNotes = 0;
+        for(const juce::MidiMessageMetadata metadata : buffer)
+        {
+            auto message = metadata.getMessage();
+            REQUIRE(message.getChannel() == 3);
+            REQUIRE(message.getNoteNumber() == 64);
+            numNotes++;
+        }
+        REQUIRE(numNotes == 2);
+    }
+    SECTION("Modulating only sends the notes that changed")
+    {
+        m.process(buffer);
+        buffer.clear();
+        m.setCenter(60);
+        m.setPivot(62);
+        m.modulate();
+        m.process(buffer);
+        REQUIRE(countSysex(buffer, {0xf0, 0x7e, 0x7f, 0x08, 0x01}) == 0);
+        REQUIRE(countSysex(buffer, {0xf0, 0x7f, 0x7f, 0x08, 0x02}) >= 1);
+    }
+    SECTION("Switching back to MPE stops sending SysEx")
+    {
+        m.setOutputMode(MidiProcessor::OutputMode::mpe);
+        m.process(buffer);
+        REQUIRE(countSysex(buffer, {0xf0}) == 0);
+    }
+}
+
+TEST_CASE("UMP output mode sends per-note pitch")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.prepareToPlay(44100.0, 512);
+    m.setOutputMode(MidiProcessor::OutputMode::ump);
+    juce::MidiBuffer buffer;
+    REQUIRE(m.loadSclString(utils::makeSclString("24-EDO", "1", {"50.0"})));
+    
+    buffer.addEvent(juce::MidiMessage::noteOn(3, 61, (juce::uint8) 127), 0);
+    buffer.addEvent(juce::MidiMessage::controllerEvent(3, 1, 64), 5);
+    buffer.addEvent(juce::MidiMessage::noteOff(3, 61), 10);
+    buffer.addEvent(juce::MidiMessage::midiClock(), 15);
+    m.process(buffer);
+    
+    REQUIRE(buffer.getNumEvents() == 0);
+    
+    const ump::PacketBuffer::Packet& noteOn = m.getUmpOutput()[0];
+    REQUIRE(noteOn.numWords == 2);
+    REQUIRE(noteOn.words[0] == 0x40923d03u); // MIDI 2.0 note on, channel 3, note 61, pitch attribute
+    REQUIRE(noteOn.words[1] >> 16 == 0xffff);
+    double expectedPitch = m.getScale().getPitch(61);
+    REQUIRE((noteOn.words[1] & 0xffff) / 512.0 == Catch::Approx(expectedPitch).margin(1.0 / 512.0));
+    
+    int next = 1;
+    if(m.getUmpOutput()[next].words[0] >> 16 == 0x4062) next++; // the part of the pitch that doesn't fit in the attribute
+    REQUIRE(m.getUmpOutput().getNumPackets() == next + 3);
+    REQUIRE(m.getUmpOutput()[next].numWords == 1);
+    REQUIRE(m.getUmpOutput()[next].words[0] == 0x20b20140u); // MIDI 1.0 controller, wrapped in a 32 bit packet
+    REQUIRE(m.getUmpOutput()[next + 1].words[0] == 0x40823d00u);
+    REQUIRE(m.getUmpOutput()[next + 2].numWords == 1);
+    REQUIRE(m.getUmpOutput()[next + 2].words[0] == 0x10f80000u); // the clock, as a system real-time packet
+}
+
+/**
+ Collects the pitch wheel messages in buffer that are on channel, as {samplePosition, pitchWheel} pairs.
+ */
+static std::vector<std::pair<int, int>> getPitchWheels(const juce::MidiBuffer& buffer, int channel)
+{
+    std::vector<std::pair<int, int>> pitchWheels;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        auto message = metadata.getMessage();
+        if(message.isPitchWheel() && message.getChannel() == channel) pitchWheels.push_back({metadata.samplePosition, message.getPitchWheelValue()});
+    }
+    return pitchWheels;
+}
+
+TEST_CASE("Held notes are retuned after a modulation")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.prepareToPlay(48000.0, 512);
+    m.setRetuneHeldNotes(true);
+    juce::MidiBuffer buffer;
+    // modulating from 60 to 61 raises every note by a syntonic comma (about 21.5 cents)
+    REQUIRE(m.loadSclString(utils::makeSclString("Comma", "2", {"81/80", "2/1"})));
+    
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+    m.process(buffer, 512);
+    int channel = 0;
+    for(const juce::MidiMessageMetadata metadata : buffer)
+    {
+        if(metadata.getMessage().isNoteOn()) channel = metadata.getMessage().getChannel();
+    }
+    REQUIRE(getPitchWheels(buffer, channel).size() == 1);
+    int oldPitchWheel = getPitchWheels(buffer, channel)[0].second;
+    const int commaInSteps = static_cast<int>(std::round(1200.0 * std::log2(81.0 / 80.0) / 100.0 * 8191)); // the pitchbend range is 1 semitone
+    
+    m.setCenter(60);
+    m.setPivot(61);
+    
+    SECTION("Without a glide, held notes are retuned in the same block")
+    {
+        m.modulate();
+        buffer.clear();
+        m.process(buffer, 512);
+        auto pitchWheels = getPitchWheels(buffer, channel);
+        REQUIRE(pitchWheels.size() == 1);
+        REQUIRE(pitchWheels[0].first == 0);
+        REQUIRE(pitchWheels[0].second == Catch::Approx(oldPitchWheel + commaInSteps).margin(2));
+    }
+    SECTION("Glides send at most one pitch wheel message per channel per interval")
+    {
+        m.setGlideTime(10.0f);
+        m.setMinTimeBetweenBends(2.0f); // 96 samples
+        m.modulate();
+        buffer.clear();
+        m.process(buffer, 512);
+        auto pitchWheels = getPitchWheels(buffer, channel);
+        REQUIRE(pitchWheels.size() == 5); // 10ms is 480 samples. The first step (at sample 0) is the old bend, so it isn't sent
+        for(size_t i = 1; i < pitchWheels.size(); i++)
+        {
+            REQUIRE(pitchWheels[i].first - pitchWheels[i - 1].first >= 96);
+            REQUIRE(pitchWheels[i].second > pitchWheels[i - 1].second);
+        }
+        REQUIRE(pitchWheels.back().second == Catch::Approx(oldPitchWheel + commaInSteps).margin(2));
+    }
+    SECTION("Glides that start in the middle of a block are timed from the modulation")
+    {
+        m.setGlideTime(10.0f);
+        m.setMinTimeBetweenBends(2.0f);
+        m.setModulationController(20);
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 127), 300);
+        m.process(buffer, 512);
+        auto pitchWheels = getPitchWheels(buffer, channel);
+        REQUIRE(pitchWheels.size() == 2); // at 396 and 492, 96 and 192 samples into the 480 sample glide
+        REQUIRE(pitchWheels[0].first == 396);
+        for(const auto& pitchWheel : pitchWheels)
+        {
+            REQUIRE(pitchWheel.second > oldPitchWheel);
+            REQUIRE(pitchWheel.second < oldPitchWheel + commaInSteps - 2); // still ramping, not jumped to the new bend
+        }
+
+        buffer.clear();
+        m.process(buffer, 512);
+        pitchWheels = getPitchWheels(buffer, channel);
+        REQUIRE(pitchWheels.size() == 3);
+        REQUIRE(pitchWheels.back().first == 780 - 512); // the glide ends 480 samples after the modulation
+        REQUIRE(pitchWheels.back().second == Catch::Approx(oldPitchWheel + commaInSteps).margin(2));
+    }
+    SECTION("Held notes keep their bend if retuning is turned off")
+    {
+        m.setRetuneHeldNotes(false);
+        m.modulate();
+        buffer.clear();
+        m.process(buffer, 512);
+        REQUIRE(getPitchWheels(buffer, channel).empty());
+    }
+    SECTION("New notes are moved by the modulation offset the same as a compiled table would move them")
+    {
+        m.modulate();
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 62, (juce::uint8) 100), 0);
+        m.process(buffer, 512);
+        
+        int newChannel = 0;
+        for(const juce::MidiMessageMetadata metadata : buffer)
+        {
+            if(metadata.getMessage().isNoteOn() && metadata.getMessage().getNoteNumber() == 62) newChannel = metadata.getMessage().getChannel();
+        }
+        REQUIRE(newChannel != 0);
+        auto pitchWheels = getPitchWheels(buffer, newChannel);
+        REQUIRE_FALSE(pitchWheels.empty());
+        RetuneTable::Entry compiled = RetuneTable::makeEntryFromPitch(62, m.getScale().getPitch(62), 1.0f);
+        REQUIRE(pitchWheels.back().second == Catch::Approx(compiled.pitchWheel).margin(2));
+    }
+}
+
+TEST_CASE("Modulations can be triggered from inside the midi stream")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.prepareToPlay(48000.0, 512);
+    juce::MidiBuffer buffer;
+    int channelBends[17];
+    std::fill(std::begin(channelBends), std::end(channelBends), 8192);
+    // keys alternate between 1/1 and 81/80, so modulating from an even key to an odd key raises every note by a syntonic comma
+    REQUIRE(m.loadSclString(utils::makeSclString("Comma", "2", {"81/80", "2/1"})));
+    const double comma = 12.0 * std::log2(81.0 / 80.0);
+    const int unmodulated = RetuneTable::makeEntryFromPitch(64, m.getScale().getUnmodulatedPitch(64), 1.0f).pitchWheel;
+    const int modulated = RetuneTable::makeEntryFromPitch(64, m.getScale().getUnmodulatedPitch(64) + comma, 1.0f).pitchWheel;
+    
+    SECTION("Reserved keys modulate from the held key to the pressed key, at the pressed key's sample")
+    {
+        m.setModulationKeyRange(0, 11);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 0, (juce::uint8) 100), 10);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 1, (juce::uint8) 100), 20);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 62, (juce::uint8) 100), 30);
+        buffer.addEvent(juce::MidiMessage::noteOff(1, 1), 40);
+        buffer.addEvent(juce::MidiMessage::noteOff(1, 0), 50);
+        m.process(buffer, 512);
+        
+        std::vector<int> pitchWheels = getNoteOnPitchWheels(buffer, channelBends);
+        REQUIRE(pitchWheels.size() == 2); // the reserved keys aren't played
+        REQUIRE(pitchWheels[0] == Catch::Approx(unmodulated).margin(2));
+        REQUIRE(pitchWheels[1] == Catch::Approx(modulated).margin(2));
+        
+        REQUIRE(m.getScale().getModulationOffset() == 0.0);
+        m.publishStreamModulations();
+        REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(comma).margin(1e-6));
+    }
+    SECTION("A controller modulates from the center to the pivot once each time it rises past 64")
+    {
+        m.setModulationController(20);
+        m.setCenter(60);
+        m.setPivot(61);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 127), 10);
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 100), 15);
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 62, (juce::uint8) 100), 30);
+        m.process(buffer, 512);
+        
+        std::vector<int> pitchWheels = getNoteOnPitchWheels(buffer, channelBends);
+        REQUIRE(pitchWheels.size() == 2);
+        REQUIRE(pitchWheels[0] == Catch::Approx(unmodulated).margin(2));
+        REQUIRE(pitchWheels[1] == Catch::Approx(modulated).margin(2));
+        for(const juce::MidiMessageMetadata metadata : buffer) REQUIRE_FALSE(metadata.getMessage().isController());
+    }
+    SECTION("Every in-stream modulation between two publishes gets its own step in the history")
+    {
+        m.setModulationController(20);
+        m.setCenter(60);
+        m.setPivot(61);
+        const int numTriggers = 3;
+        for(int i = 0; i < numTriggers; i++)
+        {
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 127), 20 * i);
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 0), 20 * i + 10);
+        }
+        m.process(buffer, 512);
+        m.publishStreamModulations();
+        REQUIRE(m.getModulationHistory().getPosition() == numTriggers);
+        for(int i = numTriggers; i > 0; i--)
+        {
+            REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(i * comma).margin(1e-6));
+            m.undo();
+        }
+        REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(0.0).margin(1e-6));
+        REQUIRE_FALSE(m.getModulationHistory().canUndo());
+    }
+    SECTION("In-stream modulations that don't fit between two publishes are merged into one step")
+    {
+        m.setModulationController(20);
+        m.setCenter(60);
+        m.setPivot(61);
+        const int numTriggers = 100;
+        for(int i = 0; i < numTriggers; i++)
+        {
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 127), 4 * i);
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 0), 4 * i + 2);
+        }
+        m.process(buffer, 512);
+        m.publishStreamModulations();
+        REQUIRE(m.getModulationHistory().getPosition() == 64 + 1);
+        REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(numTriggers * comma).margin(1e-6));
+        m.undo();
+        REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(64 * comma).margin(1e-6));
+    }
+    SECTION("A program change resets the modulation, so every render of a sequence is the same")
+    {
+        m.setModulationController(20);
+        m.setProgramChangeResetsModulation(true);
+        m.setCenter(60);
+        m.setPivot(61);
+        for(int render = 0; render < 3; render++)
+        {
+            buffer.clear();
+            buffer.addEvent(juce::MidiMessage::programChange(1, 0), 0);
+            buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 5);
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 127), 10);
+            buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 0), 20);
+            buffer.addEvent(juce::MidiMessage::noteOn(1, 62, (juce::uint8) 100), 30);
+            buffer.addEvent(juce::MidiMessage::noteOff(1, 64), 40);
+            buffer.addEvent(juce::MidiMessage::noteOff(1, 62), 50);
+            m.process(buffer, 512);
+            
+            std::vector<int> pitchWheels = getNoteOnPitchWheels(buffer, channelBends);
+            REQUIRE(pitchWheels.size() == 2);
+            REQUIRE(pitchWheels[0] == Catch::Approx(unmodulated).margin(2));
+            REQUIRE(pitchWheels[1] == Catch::Approx(modulated).margin(2));
+        }
+    }
+}
+
+#if MICROMOD_CHECK_ALLOCATIONS
+TEST_CASE("Many modulations in one block are merged instead of allocating")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.setModulationController(20);
+    m.setCenter(60);
+    m.setPivot(61);
+    
+    SECTION("MTS output") { m.setOutputMode(MidiProcessor::OutputMode::mts); }
+    SECTION("A static channel layout") { m.setUseStaticChannelLayout(true); }
+    SECTION("Held notes that glide")
+    {
+        m.setRetuneHeldNotes(true);
+        m.setGlideTime(10.0f);
+    }
+    
+    m.prepareToPlay(48000.0, 512);
+    REQUIRE(m.loadSclString(utils::makeSclString("Comma", "2", {"81/80", "2/1"})));
+    const double comma = 12.0 * std::log2(81.0 / 80.0);
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 0);
+    m.process(buffer, 512);
+    
+    const int numTriggers = 20;
+    buffer.clear();
+    for(int i = 0; i < numTriggers; i++)
+    {
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 127), 10 * i);
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, 20, 0), 10 * i + 5);
+    }
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 62, (juce::uint8) 100), 300);
+    int allocationsBefore = allocation_checker::getNumAllocations();
+    {
+        allocation_checker::ScopedNoAllocations noAllocations;
+        m.process(buffer, 512);
+    }
+    REQUIRE(allocation_checker::getNumAllocations() == allocationsBefore);
+    REQUIRE(countSysex(buffer, {0xf0, 0x7f, 0x7f, 0x08, 0x02}) <= 4 * 2); // at most 4 retunes, of up to 2 messages each
+    
+    m.publishStreamModulations();
+    REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(numTriggers * comma).margin(1e-6));
+}
+#endif
+
+TEST_CASE("Host parameters drive modulation without touching the ValueTree")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.prepareToPlay(48000.0, 512);
+    std::atomic<float> center(60.0f), pivot(61.0f), modulate(0.0f), referenceFreq(440.0f), morph(1.0f);
+    MidiProcessor::HostParameters parameters;
+    parameters.center = &center;
+    parameters.pivot = &pivot;
+    parameters.modulate = &modulate;
+    parameters.referenceFreq = &referenceFreq;
+    parameters.morph = &morph;
+    m.setHostParameters(parameters);
+    juce::MidiBuffer buffer;
+    int channelBends[17];
+    std::fill(std::begin(channelBends), std::end(channelBends), 8192);
+    REQUIRE(m.loadSclString(utils::makeSclString("Comma", "2", {"81/80", "2/1"})));
+    const double comma = 12.0 * std::log2(81.0 / 80.0);
+    const double pitch = m.getScale().getUnmodulatedPitch(64);
+    
+    /**
+     Plays note 64 in its own block, and returns the pitch wheel it was played with.
+     */
+    auto playNote = [&]()
+    {
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::noteOff(1, 64), 10);
+        m.process(buffer, 512);
+        std::vector<int> pitchWheels = getNoteOnPitchWheels(buffer, channelBends);
+        REQUIRE(pitchWheels.size() == 1);
+        return pitchWheels[0];
+    };
+    
+    REQUIRE(playNote() == Catch::Approx(RetuneTable::makeEntryFromPitch(64, pitch, 1.0f).pitchWheel).margin(2));
+    
+    SECTION("Modulate modulates from center to pivot once each time it turns on")
+    {
+        modulate = 1.0f;
+        REQUIRE(playNote() == Catch::Approx(RetuneTable::makeEntryFromPitch(64, pitch + comma, 1.0f).pitchWheel).margin(2));
+        REQUIRE(playNote() == Catch::Approx(RetuneTable::makeEntryFromPitch(64, pitch + comma, 1.0f).pitchWheel).margin(2));
+        m.publishStreamModulations();
+        REQUIRE(m.getScale().getModulationOffset() == Catch::Approx(comma).margin(1e-6));
+        
+        SECTION("Morph moves between the unmodulated and modulated tunings")
+        {
+            morph = 0.5f;
+            REQUIRE(playNote() == Catch::Approx(RetuneTable::makeEntryFromPitch(64, pitch + comma / 2.0, 1.0f).pitchWheel).margin(2));
+            morph = 0.0f;
+            REQUIRE(playNote() == Catch::Approx(RetuneTable::makeEntryFromPitch(64, pitch, 1.0f).pitchWheel).margin(2));
+        }
+    }
+    SECTION("The reference frequency transposes the tuning")
+    {
+        referenceFreq = 440.0f * std::pow(2.0f, 0.25f / 12.0f);
+        REQUIRE(playNote() == Catch::Approx(RetuneTable::makeEntryFromPitch(64, pitch + 0.25, 1.0f).pitchWheel).margin(2));
+    }
+}
+
+TEST_CASE("Identical pitch wheel messages are only sent once per channel")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.setPoolChannelsByBend(false);
+    juce::MidiBuffer buffer;
+    REQUIRE(m.loadSclString(utils::makeSclString("24-EDO", "1", {"50.0"})));
+    
+    int numPitchWheels = 0;
+    for(int i = 0; i < 10; i++) // repeated notes
+    {
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 61, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::noteOff(1, 61), 10);
+        m.process(buffer);
+        numPitchWheels += countPitchWheels(buffer);
+    }
+    REQUIRE(numPitchWheels == 1);
+    REQUIRE(m.getNumPitchWheelsSaved() == 9);
+}
+
+TEST_CASE("Pitch wheels are sent again after the synth may have been reset")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    m.prepareToPlay(44100.0, 512);
+    m.setPoolChannelsByBend(false);
+    juce::MidiBuffer buffer;
+    REQUIRE(m.loadSclString(utils::makeSclString("24-EDO", "1", {"50.0"})));
+    
+    // every odd note needs the same bend, so this bends every member channel to it
+    for(int i = 0; i < 15; i++) buffer.addEvent(juce::MidiMessage::noteOn(1, 61 + 2 * i, (juce::uint8) 100), i);
+    for(int i = 0; i < 15; i++) buffer.addEvent(juce::MidiMessage::noteOff(1, 61 + 2 * i), 20 + i);
+    m.process(buffer);
+    REQUIRE(countPitchWheels(buffer) == 15);
+    
+    /**
+     Plays note 61 in its own block, and returns the number of pitch wheel messages it needed.
+     */
+    auto playNote = [&]()
+    {
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 61, (juce::uint8) 100), 0);
+        buffer.addEvent(juce::MidiMessage::noteOff(1, 61), 10);
+        m.process(buffer);
+        return countPitchWheels(buffer);
+    };
+    REQUIRE(playNote() == 0);
+    
+    SECTION("Reset all controllers")
+    {
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::controllerEvent(1, 121, 0), 0);
+        m.process(buffer);
+        REQUIRE(buffer.getNumEvents() == 1); // it is still passed through
+    }
+    SECTION("All notes off")
+    {
+        buffer.clear();
+        buffer.addEvent(juce::MidiMessage::allNotesOff(1), 0);
+        m.process(buffer);
+    }
+    SECTION("prepareToPlay()")
+    {
+        m.prepareToPlay(48000.0, 256);
+    }
+    SECTION("A new output mode")
+    {
+        m.setOutputMode(MidiProcessor::OutputMode::mts);
+        buffer.clear();
+        m.process(buffer);
+        m.setOutputMode(MidiProcessor::OutputMode::mpe);
+    }
+    REQUIRE(playNote() == 1);
+    REQUIRE(playNote() == 0);
+}
@@ -0,0 +1,150 @@
+/*
+ ==============================================================================
+
+ TestModulationHistory.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/MidiProcessor.h"
+#include "../../MicroModulation/Source/ModulationHistory.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("ModulationHistory undoes, redoes, and jumps exactly within its memory cap")
+{
+    ModulationHistory history(1024);
+    REQUIRE(history.getMemoryUsage() <= 1024);
+    REQUIRE_FALSE(history.canUndo());
+    REQUIRE_FALSE(history.canRedo());
+
+    std::vector<juce::int64> offsets{0}; // offsets[p] is the offset at position p
+    juce::Random random(22);
+    const int numSteps = static_cast<int>(history.getCapacity()) * 3;
+    for(int i = 0; i < numSteps; i++)
+    {
+        juce::int64 delta = random.nextInt64() % (RetuneTable::fixedPointSemitone * 12);
+        history.push(delta, i % 128, (i + 7) % 128);
+        offsets.push_back(offsets.back() + delta);
+        REQUIRE(history.getOffset() == offsets.back());
+    }
+
+    SECTION("The oldest steps are dropped once the cap is reached")
+    {
+        REQUIRE(history.getLastPosition() == numSteps);
+        REQUIRE(history.getLastPosition() - history.getFirstPosition() == history.getCapacity());
+        REQUIRE(history.getBaseOffset() == offsets[static_cast<size_t>(history.getFirstPosition())]);
+        REQUIRE(history.getMemoryUsage() <= 1024);
+    }
+    SECTION("Undo and redo step through every kept position exactly")
+    {
+        while(history.canUndo())
+        {
+            juce::int64 offset = history.undo();
+            REQUIRE(offset == offsets[static_cast<size_t>(history.getPosition())]);
+        }
+        REQUIRE(history.getPosition() == history.getFirstPosition());
+        REQUIRE(history.getOffset() == history.getBaseOffset());
+        while(history.canRedo()) REQUIRE(history.redo() == offsets[static_cast<size_t>(history.getPosition())]);
+        REQUIRE(history.getOffset() == offsets.back());
+    }
+    SECTION("jumpTo() reaches any kept position, including ones whose checkpoint was dropped")
+    {
+        for(juce::int64 position = history.getLastPosition(); position >= history.getFirstPosition(); position--)
+        {
+            REQUIRE(history.jumpTo(position) == offsets[static_cast<size_t>(position)]);
+            REQUIRE(history.getPosition() == position);
+        }
+        REQUIRE(history.jumpTo(0) == history.getBaseOffset()); //positions that were dropped are clamped to the oldest one
+    }
+    SECTION("A new step after an undo discards the steps that could have been redone")
+    {
+        history.undo();
+        history.undo();
+        history.push(5, 60, 62);
+        REQUIRE_FALSE(history.canRedo());
+        REQUIRE(history.getLastPosition() == numSteps - 1);
+        REQUIRE(history.getOffset() == offsets[static_cast<size_t>(numSteps - 2)] + 5);
+        REQUIRE(history.getStep(history.getLastPosition() - 1).center == 60);
+    }
+}
+
+TEST_CASE("MidiProcessor undoes modulations with its ModulationHistory")
+{
+    juce::UndoManager um;
+    MidiProcessor m(um);
+    REQUIRE(m.loadSclString(utils::makeSclString("Pelog", "7", {"120.", "270.", "540.", "670.", "785.", "950.", "1200."})));
+
+    const int numUndoActions = um.getNumActionsInCurrentTransaction();
+    std::vector<double> offsets{m.getScale().getModulationOffset()};
+    std::vector<std::pair<int, int>> notePairs{{62, 64}, {60, 67}, {65, 61}};
+    for(auto [center, pivot] : notePairs)
+    {
+        m.setCenter(center);
+        m.setPivot(pivot);
+        m.modulate();
+        offsets.push_back(m.getScale().getModulationOffset());
+    }
+    REQUIRE(m.getModulationHistory().getPosition() == 3);
+    REQUIRE(offsets.back() != offsets.front());
+    REQUIRE(um.getNumActionsInCurrentTransaction() == numUndoActions); //modulations, centers, and pivots aren't recorded by the UndoManager
+
+    SECTION("Undo goes back one modulation at a time, and restores its center and pivot")
+    {
+        m.undo();
+        REQUIRE(m.getScale().getModulationOffset() == offsets[2]);
+        REQUIRE(static_cast<int>(m.midiProcessorValues.getProperty(IDs::modCenter)) == 65);
+        REQUIRE(static_cast<int>(m.midiProcessorValues.getProperty(IDs::modPivot)) == 61);
+        m.undo();
+        m.undo();
+        REQUIRE(m.getScale().getModulationOffset() == offsets[0]);
+        m.undo(); //nothing left to undo
+        REQUIRE(m.getScale().getModulationOffset() == offsets[0]);
+
+        m.redo();
+        REQUIRE(m.getScale().getModulationOffset() == offsets[1]);
+        REQUIRE(static_cast<int>(m.midiProcessorValues.getProperty(IDs::modCenter)) == 62);
+    }
+    SECTION("jumpTo() recalls any earlier modulation")
+    {
+        m.jumpTo(1);
+        REQUIRE(m.getScale().getModulationOffset() == offsets[1]);
+        m.jumpTo(3);
+        REQUIRE(m.getScale().getModulationOffset() == offsets[3]);
+    }
+    SECTION("The history is saved with the plugin state")
+    {
+        m.undo();
+        MidiProcessor restored(um);
+        REQUIRE(restored.setState(m.getState()));
+        REQUIRE(restored.getScale().getModulationOffset() == offsets[2]);
+        REQUIRE(restored.getModulationHistory().canRedo());
+        restored.redo();
+        REQUIRE(restored.getScale().getModulationOffset() == offsets[3]);
+    }
+    SECTION("Loading a new tuning clears the history")
+    {
+        REQUIRE(m.loadSclString(utils::makeSclString("12-TET", "1", {"100.0"})));
+        REQUIRE_FALSE(m.getModulationHistory().canUndo());
+        m.undo();
+        REQUIRE(m.getScale().getModulationOffset() == 0.0);
+    }
+    SECTION("Undoing a load restores the tuning it replaced, unmodulated")
+    {
+        const double pelogPitch = m.getScale().getUnmodulatedPitch(64);
+        REQUIRE(m.loadSclString(utils::makeSclString("12-TET", "1", {"100.0"})));
+        m.modulate();
+        REQUIRE(m.undoLoad());
+        REQUIRE(m.getScale().getNumNotes() == 7);
+        REQUIRE(m.getScale().getPitch(64) == pelogPitch);
+        REQUIRE_FALSE(m.getModulationHistory().canUndo());
+
+        REQUIRE(m.redoLoad());
+        REQUIRE(m.getScale().getNumNotes() == 1);
+        REQUIRE(m.getScale().getPitch(64) == Catch::Approx(64.0));
+        REQUIRE_FALSE(m.redoLoad()); //nothing left to redo
+    }
+}
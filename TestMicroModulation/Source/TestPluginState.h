@@ -0,0 +1,197 @@
+/*
+ ==============================================================================
+
+ TestPluginState.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/MidiProcessor.h"
+#include "../../MicroModulation/Source/PluginState.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("PluginState saves and restores the tuning without any files")
+{
+    juce::UndoManager um;
+    MidiProcessor saved(um);
+    REQUIRE(saved.loadSclString(utils::makeSclString("Pelog", "7", {"120.", "270.", "540.", "670.", "785.", "950.", "1200."})));
+    REQUIRE(saved.loadKbmString("3\n0\n127\n62\n68\n432.0\n2\n0\nx\n1\n"));
+    saved.setCenter(62);
+    saved.setPivot(64);
+    saved.modulate();
+
+    PluginState state = saved.getState();
+    state.parameters = {0.25f, 0.5f, 1.0f};
+    juce::MemoryBlock blob;
+    state.writeTo(blob);
+
+    SECTION("A restored processor has the same tuning, center, pivot, and modulation")
+    {
+        PluginState loaded;
+        REQUIRE(loaded.readFrom(blob.getData(), static_cast<int>(blob.getSize())));
+        REQUIRE(loaded.parameters == state.parameters);
+
+        juce::UndoManager restoredUm;
+        MidiProcessor restored(restoredUm);
+        REQUIRE(restored.setState(loaded));
+        REQUIRE(restored.getScale().getDescription() == "Pelog");
+        REQUIRE(restored.getScale().getNoteRatios() == saved.getScale().getNoteRatios());
+        REQUIRE(restored.getScale().getKeyboardMap().getScaleDegrees() == saved.getScale().getKeyboardMap().getScaleDegrees());
+        REQUIRE(static_cast<int>(restored.midiProcessorValues.getProperty(IDs::modCenter)) == 62);
+        REQUIRE(static_cast<int>(restored.midiProcessorValues.getProperty(IDs::modPivot)) == 64);
+        REQUIRE(restored.getScale().getModulationOffset() == Catch::Approx(saved.getScale().getModulationOffset()));
+        for(juce::int8 note = 0; note < 127; note++)
+        {
+            double pitch = saved.getScale().getPitch(note);
+            if(std::isnan(pitch)) REQUIRE(std::isnan(restored.getScale().getPitch(note)));
+            else REQUIRE(restored.getScale().getPitch(note) == Catch::Approx(pitch).margin(1e-9));
+        }
+        REQUIRE_FALSE(restoredUm.canUndo());
+    }
+    SECTION("Corrupted, truncated, and unknown blobs are rejected")
+    {
+        PluginState loaded;
+        juce::MemoryBlock corrupted(blob);
+        static_cast<char*>(corrupted.getData())[corrupted.getSize() - 3] ^= 0x40;
+        REQUIRE_FALSE(loaded.readFrom(corrupted.getData(), static_cast<int>(corrupted.getSize())));
+        REQUIRE_FALSE(loaded.readFrom(blob.getData(), static_cast<int>(blob.getSize()) - 1));
+        REQUIRE_FALSE(loaded.readFrom(blob.getData(), 8));
+        REQUIRE_FALSE(loaded.readFrom(nullptr, 0));
+
+        juce::MemoryBlock newerVersion(blob);
+        static_cast<juce::uint8*>(newerVersion.getData())[4] = PluginState::version + 1;
+        REQUIRE_FALSE(loaded.readFrom(newerVersion.getData(), static_cast<int>(newerVersion.getSize())));
+        REQUIRE(loaded.noteRatios.empty()); //nothing was changed by the failed reads
+    }
+}
+
+TEST_CASE("A state saved with modulate on doesn't modulate again when it is restored")
+{
+    const double comma = 12.0 * std::log2(81.0 / 80.0);
+    std::atomic<float> center(60.0f), pivot(61.0f), modulate(0.0f);
+    MidiProcessor::HostParameters parameters;
+    parameters.center = &center;
+    parameters.pivot = &pivot;
+    parameters.modulate = &modulate;
+    
+    juce::UndoManager um;
+    MidiProcessor saved(um);
+    saved.setHostParameters(parameters);
+    saved.prepareToPlay(48000.0, 512);
+    REQUIRE(saved.loadSclString(utils::makeSclString("Comma", "2", {"81/80", "2/1"})));
+    juce::MidiBuffer buffer;
+    saved.process(buffer, 512);
+    modulate = 1.0f;
+    saved.process(buffer, 512);
+    
+    PluginState state = saved.getState();
+    REQUIRE(state.historySteps.size() == 1);
+    state.parameters = {center.load(), pivot.load(), modulate.load()};
+    juce::MemoryBlock blob;
+    state.writeTo(blob);
+    
+    // a new instance, as the host restores it: parameters at their defaults, then the saved parameters, then the state
+    std::atomic<float> restoredCenter(60.0f), restoredPivot(60.0f), restoredModulate(0.0f);
+    parameters.center = &restoredCenter;
+    parameters.pivot = &restoredPivot;
+    parameters.modulate = &restoredModulate;
+    juce::UndoManager restoredUm;
+    MidiProcessor restored(restoredUm);
+    restored.setHostParameters(parameters);
+    restored.prepareToPlay(48000.0, 512);
+    restored.process(buffer, 512);
+    
+    PluginState loaded;
+    REQUIRE(loaded.readFrom(blob.getData(), static_cast<int>(blob.getSize())));
+    restoredCenter = loaded.parameters[0];
+    restoredPivot = loaded.parameters[1];
+    restoredModulate = loaded.parameters[2];
+    REQUIRE(restored.setState(loaded));
+    
+    restored.process(buffer, 512);
+    restored.publishStreamModulations();
+    REQUIRE(restored.getScale().getModulationOffset() == Catch::Approx(comma).margin(1e-6));
+    REQUIRE(restored.getModulationHistory().getPosition() == 1);
+    
+    // turning it off and on again still modulates
+    restoredModulate = 0.0f;
+    restored.process(buffer, 512);
+    restoredModulate = 1.0f;
+    restored.process(buffer, 512);
+    restored.publishStreamModulations();
+    REQUIRE(restored.getScale().getModulationOffset() == Catch::Approx(2.0 * comma).margin(1e-6));
+}
+
+/**
+ Writes state as a version 1 blob, which saved the modulation offset in semitones instead of the modulation history.
+ */
+static void writeVersion1Blob(const PluginState& state, double modulationOffset, juce::MemoryBlock& dest)
+{
+    juce::MemoryOutputStream payload;
+    payload.writeBool(state.hasScl);
+    payload.writeInt(static_cast<int>(state.description.size()));
+    payload.write(state.description.data(), state.description.size());
+    payload.writeInt(static_cast<int>(state.noteRatios.size()));
+    for(double ratio : state.noteRatios) payload.writeDouble(ratio);
+    payload.writeInt(state.kbm.retuneRangeLowerBound);
+    payload.writeInt(state.kbm.retuneRangeUpperBound);
+    payload.writeInt(state.kbm.middleNote);
+    payload.writeInt(state.kbm.referenceNote);
+    payload.writeFloat(state.kbm.referenceFreq);
+    payload.writeInt(state.kbm.formalOctaveScaleDegree);
+    payload.writeInt(static_cast<int>(state.kbm.mapping.size()));
+    for(int scaleDegree : state.kbm.mapping) payload.writeShort(static_cast<short>(scaleDegree));
+    payload.writeInt(state.center);
+    payload.writeInt(state.pivot);
+    payload.writeDouble(modulationOffset);
+    payload.writeInt(static_cast<int>(state.parameters.size()));
+    for(float value : state.parameters) payload.writeFloat(value);
+    
+    juce::MemoryOutputStream out(dest, false);
+    out.writeInt(static_cast<int>(PluginState::magic));
+    out.writeInt(1);
+    out.writeInt(static_cast<int>(payload.getDataSize()));
+    out.writeInt(static_cast<int>(PluginState::makeChecksum(payload.getData(), payload.getDataSize())));
+    out.write(payload.getData(), payload.getDataSize());
+}
+
+TEST_CASE("States saved before the modulation history are upgraded")
+{
+    juce::UndoManager um;
+    MidiProcessor saved(um);
+    REQUIRE(saved.loadSclString(utils::makeSclString("Pelog", "7", {"120.", "270.", "540.", "670.", "785.", "950.", "1200."})));
+    saved.setCenter(62);
+    saved.setPivot(64);
+    saved.modulate();
+    PluginState state = saved.getState();
+    state.parameters = {0.25f, 0.5f, 1.0f};
+    juce::MemoryBlock blob;
+    writeVersion1Blob(state, saved.getScale().getModulationOffset(), blob);
+    
+    PluginState loaded;
+    REQUIRE(loaded.readFrom(blob.getData(), static_cast<int>(blob.getSize())));
+    REQUIRE(loaded.description == "Pelog");
+    REQUIRE(loaded.center == 62);
+    REQUIRE(loaded.pivot == 64);
+    REQUIRE(loaded.parameters == state.parameters);
+    REQUIRE(loaded.historySteps.empty());
+    REQUIRE(loaded.historyBaseOffset == RetuneTable::toFixedOffset(saved.getScale().getModulationOffset()));
+    
+    juce::UndoManager restoredUm;
+    MidiProcessor restored(restoredUm);
+    REQUIRE(restored.setState(loaded));
+    REQUIRE(restored.getScale().getModulationOffset() == Catch::Approx(saved.getScale().getModulationOffset()).margin(1e-6));
+    REQUIRE(restored.getScale().getPitch(60) == Catch::Approx(saved.getScale().getPitch(60)).margin(1e-6));
+    REQUIRE_FALSE(restored.getModulationHistory().canUndo()); // there is nothing to undo back to
+    
+    SECTION("A corrupted version 1 blob is still rejected")
+    {
+        static_cast<char*>(blob.getData())[blob.getSize() - 3] ^= 0x40;
+        PluginState rejected;
+        REQUIRE_FALSE(rejected.readFrom(blob.getData(), static_cast<int>(blob.getSize())));
+    }
+}
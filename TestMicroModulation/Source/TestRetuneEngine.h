@@ -0,0 +1,60 @@
+/*
+ ==============================================================================
+
+ TestRetuneEngine.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <cmath>
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulationEngine/Source/RetuneEngine.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("RetuneEngine compiles tunings and processes events through its own API")
+{
+    RetuneEngine engine;
+    engine.prepare(44100.0, 512);
+    REQUIRE(std::isnan(engine.getPitch(60))); //nothing is loaded yet
+    REQUIRE(engine.loadScl(utils::makeSclString("Pelog", "7", {"120.", "270.", "540.", "670.", "785.", "950.", "1200."})));
+    REQUIRE(engine.loadKbm("3\n0\n127\n62\n68\n432.0\n2\n0\nx\n1\n"));
+    const double pitch = engine.getPitch(64);
+
+    SECTION("Invalid text leaves the tuning unchanged")
+    {
+        REQUIRE_FALSE(engine.loadScl("not a scale"));
+        REQUIRE_FALSE(engine.loadKbm("not a map"));
+        REQUIRE(engine.getPitch(64) == pitch);
+    }
+    SECTION("Notes are retuned with MPE")
+    {
+        juce::MidiBuffer buffer;
+        buffer.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8) 100), 10);
+        engine.process(buffer, 512);
+
+        int numNoteOns = 0;
+        int numPitchWheels = 0;
+        for(const juce::MidiMessageMetadata metadata : buffer)
+        {
+            auto message = metadata.getMessage();
+            if(message.isNoteOn()) numNoteOns++;
+            if(message.isPitchWheel()) numPitchWheels++;
+        }
+        REQUIRE(numNoteOns == 1);
+        REQUIRE(numPitchWheels >= 1);
+    }
+    SECTION("Modulations can be made and undone")
+    {
+        REQUIRE_FALSE(engine.modulate(62, 62));
+        REQUIRE(engine.modulate(62, 64));
+        REQUIRE(engine.getModulationOffset() != 0.0);
+        REQUIRE(engine.getPitch(64) == Catch::Approx(pitch + engine.getModulationOffset()));
+        REQUIRE(engine.undoModulation());
+        REQUIRE(engine.getPitch(64) == Catch::Approx(pitch));
+        REQUIRE_FALSE(engine.undoModulation());
+    }
+}
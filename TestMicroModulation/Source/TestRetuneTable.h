@@ -0,0 +1,79 @@
+/*
+ ==============================================================================
+ 
+ TestRetuneTable.h
+ 
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/RetuneTable.h"
+#include "../../MicroModulation/Source/Scale.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("RetuneTable compiles note numbers and pitchwheel positions")
+{
+    juce::UndoManager um;
+    Scale s(um);
+    RetuneTable table;
+    
+    SECTION("Without a .scl loaded, every note is unmapped")
+    {
+        table.compile(s, 2.0f);
+        for(int noteNum = 0; noteNum < 128; noteNum++)
+        {
+            REQUIRE_FALSE(table[noteNum].isMapped);
+        }
+    }
+    SECTION("12-TET maps every note to itself with no pitchbend")
+    {
+        s.loadSclString(utils::makeSclString("12-TET 12 notes", "12", {"100.0", "200.0", "300.0", "400.0", "500.0", "600.0", "700.0", "800.0", "900.0", "1000.0", "1100.0", "1200.0"}));
+        table.compile(s, 2.0f);
+        for(int noteNum = 0; noteNum < 128; noteNum++)
+        {
+            REQUIRE(table[noteNum].isMapped);
+            REQUIRE(table[noteNum].noteNumber == noteNum);
+            REQUIRE(table[noteNum].pitchWheel == Catch::Approx(8192).margin(1));
+        }
+    }
+    SECTION("Pitchwheel positions bend towards the exact frequency")
+    {
+        RetuneTable::Entry quarterSharp = RetuneTable::makeEntry(60, utils::getMidiNoteInHertz(60, 440.0) * std::pow(2.0, 0.25 / 12.0), 2.0f);
+        REQUIRE(quarterSharp.isMapped);
+        REQUIRE(quarterSharp.noteNumber == 60);
+        REQUIRE(quarterSharp.pitchWheel == Catch::Approx(8192 + 1024).margin(1));
+        
+        RetuneTable::Entry quarterFlat = RetuneTable::makeEntry(60, utils::getMidiNoteInHertz(60, 440.0) * std::pow(2.0, -0.25 / 12.0), 2.0f);
+        REQUIRE(quarterFlat.noteNumber == 60);
+        REQUIRE(quarterFlat.pitchWheel == Catch::Approx(8192 - 1024).margin(1));
+    }
+    SECTION("The exact pitch is kept in 7.25 fixed point")
+    {
+        RetuneTable::Entry quarterSharp = RetuneTable::makeEntry(60, utils::getMidiNoteInHertz(60, 440.0) * std::pow(2.0, 0.25 / 12.0), 2.0f);
+        REQUIRE(RetuneTable::toMidiPitch(quarterSharp.pitch) == Catch::Approx(60.25).margin(1e-6));
+        REQUIRE(RetuneTable::toFixedPitch(60.25) == (60u << 25) + (1u << 23));
+        REQUIRE(RetuneTable::toFixedPitch(-1.0) == 0);
+        REQUIRE(RetuneTable::toFixedPitch(200.0) == 0xffffffffu);
+    }
+    SECTION("Unplayable frequencies are unmapped")
+    {
+        REQUIRE_FALSE(RetuneTable::makeEntry(60, -1.0, 2.0f).isMapped);
+        REQUIRE_FALSE(RetuneTable::makeEntry(60, 100000.0, 2.0f).isMapped);
+    }
+    SECTION("Transposing by an offset matches compiling the moved pitch")
+    {
+        RetuneTable::Entry entry = RetuneTable::makeEntryFromPitch(60, 60.25, 2.0f);
+        RetuneTable::Entry moved = RetuneTable::transpose(entry, RetuneTable::toFixedOffset(0.5), 2.0f);
+        RetuneTable::Entry compiled = RetuneTable::makeEntryFromPitch(60, 60.75, 2.0f);
+        REQUIRE(moved.isMapped);
+        REQUIRE(moved.noteNumber == compiled.noteNumber);
+        REQUIRE(moved.pitchWheel == Catch::Approx(compiled.pitchWheel).margin(1));
+        REQUIRE(moved.pitch == compiled.pitch);
+        
+        REQUIRE_FALSE(RetuneTable::transpose(entry, RetuneTable::toFixedOffset(-61.0), 2.0f).isMapped);
+        REQUIRE_FALSE(RetuneTable::transpose(entry, RetuneTable::toFixedOffset(68.0), 2.0f).isMapped);
+    }
+}
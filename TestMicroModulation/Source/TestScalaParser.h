@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+
+ TestScalaParser.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/ScalaParser.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("utils::trimLine() removes white space, comments, and carriage returns")
+{
+    REQUIRE(utils::trimLine("  \t3/2 ! a fifth") == "3/2 ");
+    REQUIRE(utils::trimLine("701.955\r") == "701.955");
+    REQUIRE(utils::trimLine("! only a comment\r").empty());
+    REQUIRE(utils::trimLine("").empty());
+    REQUIRE(utils::isBlank(" \t\r"));
+    REQUIRE_FALSE(utils::isBlank(" x "));
+    REQUIRE(utils::removeWhiteSpace(" a b\r") == "ab");
+}
+
+TEST_CASE("scala::parseScl() reads .scl text from memory")
+{
+    SECTION("Ratios and cents are both converted to ratios")
+    {
+        scala::SclData scl = scala::parseScl("! a comment\nJust fifth\n 2\n3/2 ! the fifth\n1200.0\n");
+        REQUIRE(scl.isValid);
+        REQUIRE(scl.description == "Just fifth");
+        REQUIRE(scl.notes.size() == 2);
+        REQUIRE(scl.notes[0] == Catch::Approx(1.5));
+        REQUIRE(scl.notes[1] == Catch::Approx(2.0));
+    }
+    SECTION("Cents and ratios keep double precision")
+    {
+        scala::SclData scl = scala::parseScl("Precise\n2\n701.955000001\n1162261467/1073741824\n");
+        REQUIRE(scl.isValid);
+        REQUIRE(scl.notes[0] == Catch::Approx(std::exp2(701.955000001 / 1200.0)).epsilon(1e-15));
+        REQUIRE(scl.notes[1] == Catch::Approx(1162261467.0 / 1073741824.0).epsilon(1e-15)); // 3^19 / 2^30, which a float can't hold
+    }
+    SECTION("Windows line breaks are handled")
+    {
+        scala::SclData scl = scala::parseScl("Octave\r\n1\r\n2/1\r\n");
+        REQUIRE(scl.isValid);
+        REQUIRE(scl.notes.size() == 1);
+        REQUIRE(scl.notes[0] == Catch::Approx(2.0));
+    }
+    SECTION("A scale with no notes has the single note 1/1")
+    {
+        scala::SclData scl = scala::parseScl("Empty\n0\n");
+        REQUIRE(scl.isValid);
+        REQUIRE(scl.notes.size() == 1);
+        REQUIRE(scl.notes[0] == 1.0);
+    }
+    SECTION("Invalid scales")
+    {
+        REQUIRE_FALSE(scala::parseScl("").isValid);
+        REQUIRE_FALSE(scala::parseScl("Too few notes\n3\n100.0\n200.0\n").isValid);
+        REQUIRE_FALSE(scala::parseScl("Negative\n1\n-3/2\n").isValid);
+        REQUIRE_FALSE(scala::parseScl("Not a number\n1\nabc\n").isValid);
+    }
+}
+
+TEST_CASE("scala::parseKbm() reads .kbm text from memory")
+{
+    SECTION("Meta values and mappings are read")
+    {
+        scala::KbmData kbm = scala::parseKbm(utils::makeKbmString(4, 0, 127, 60, 69, 440.0, 7, {"0", "x", "2"}), 7);
+        REQUIRE(kbm.isValid);
+        REQUIRE(kbm.middleNote == 60);
+        REQUIRE(kbm.referenceFreq == Catch::Approx(440.0f));
+        REQUIRE(kbm.formalOctaveScaleDegree == 6);
+        REQUIRE(kbm.mapping == std::vector<int>{0, -1, 2, -1}); // the rest of the map is unmapped
+    }
+    SECTION("Invalid maps")
+    {
+        REQUIRE_FALSE(scala::parseKbm(utils::makeKbmString(1, 0, 127, 60, 69, 440.0, 8, {"0"}), 7).isValid); // the formal octave isn't in the scale
+        REQUIRE_FALSE(scala::parseKbm(utils::makeKbmString(1, 0, 127, 60, 69, 440.0, 7, {"0", "1"}), 7).isValid); // too many mappings
+        REQUIRE_FALSE(scala::parseKbm("1\n0\n127\n", 7).isValid); // missing meta values
+    }
+}
+
+/**
+ Times parse over text, and prints how many lines and megabytes it parses per second.
+ */
+template <typename ParseFunction>
+static void reportParseThroughput(const std::string& name, const std::string& text, ParseFunction parse)
+{
+    const int numRepeats = 200;
+    size_t numLines = static_cast<size_t>(std::count(text.begin(), text.end(), '\n'));
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < numRepeats; i++) REQUIRE(parse(text));
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << numLines * numRepeats / seconds.count() << " lines/sec, "
+              << text.size() * numRepeats / seconds.count() / (1024.0 * 1024.0) << " MB/sec" << std::endl;
+}
+
+TEST_CASE("Benchmark .scl and .kbm parsing", "[.][benchmark]")
+{
+    // a synthetic 1000 note scale, with a mix of cents, ratios, and comments
+    std::string scl = "! synthetic.scl\n!\nSynthetic 1000 note scale\n 1000\n!\n";
+    for(int i = 1; i <= 1000; i++)
+    {
+        if(i % 2 == 0) scl += " " + std::to_string(i * 1.2) + "\r\n";
+        else scl += std::to_string(1000 + i) + "/1000 ! note " + std::to_string(i) + "\n";
+    }
+    std::string kbm = "! synthetic.kbm\n1000\n0\n127\n60\n69\n440.0\n1000\n";
+    for(int i = 0; i < 1000; i++) kbm += (i % 7 == 0 ? std::string("x") : std::to_string(i)) + "\n";
+
+    reportParseThroughput(".scl", scl, [](const std::string& text) { return scala::parseScl(text).isValid; });
+    reportParseThroughput(".kbm", kbm, [](const std::string& text) { return scala::parseKbm(text, 1000).isValid; });
+
+    BENCHMARK("Parse a 1000 note .scl") { return scala::parseScl(scl); };
+    BENCHMARK("Parse a 1000 key .kbm") { return scala::parseKbm(kbm, 1000); };
+}
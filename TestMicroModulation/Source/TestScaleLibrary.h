@@ -0,0 +1,108 @@
+/*
+ ==============================================================================
+
+ TestScaleLibrary.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/ScaleLibrary.h"
+
+TEST_CASE("ScaleLibrary indexes and searches a folder of Scala files")
+{
+    juce::File directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("ScaleLibraryTest", "");
+    REQUIRE(directory.createDirectory().wasOk());
+    juce::File subdirectory = directory.getChildFile("more");
+    REQUIRE(subdirectory.createDirectory().wasOk());
+
+    directory.getChildFile("12edo.scl").replaceWithText("12 tone equal temperament\n12\n100.\n200.\n300.\n400.\n500.\n600.\n700.\n800.\n900.\n1000.\n1100.\n2/1\n");
+    directory.getChildFile("pelog.scl").replaceWithText("Pelog, gamelan tuning\n7\n120.\n270.\n540.\n670.\n785.\n950.\n1200.\n");
+    subdirectory.getChildFile("tritave.scl").replaceWithText("Bohlen-Pierce equal temperament\n13\n146.3\n292.6\n438.9\n585.2\n731.5\n877.8\n1024.1\n1170.4\n1316.7\n1463.\n1609.3\n1755.6\n3/1\n");
+    subdirectory.getChildFile("broken.scl").replaceWithText("Broken\n2\n3/2\n");
+    subdirectory.getChildFile("whole.kbm").replaceWithText("6\n0\n127\n60\n69\n440.0\n6\n0\n2\n4\n6\n8\n10\n");
+
+    ScaleLibrary library;
+    REQUIRE(library.scan(directory) == 5);
+    REQUIRE(library.getNumEntries() == 5);
+
+    SECTION("Entries record what was parsed, and why files couldn't be")
+    {
+        const ScaleLibrary::Entry* pelog = library.getEntry(directory.getChildFile("pelog.scl").getFullPathName().toStdString());
+        REQUIRE(pelog != nullptr);
+        REQUIRE(pelog->isValid);
+        REQUIRE(pelog->numNotes == 7);
+        REQUIRE(pelog->periodCents == Catch::Approx(1200.0).margin(0.01));
+
+        const ScaleLibrary::Entry* broken = library.getEntry(subdirectory.getChildFile("broken.scl").getFullPathName().toStdString());
+        REQUIRE(broken != nullptr);
+        REQUIRE_FALSE(broken->isValid);
+        REQUIRE_FALSE(broken->error.empty());
+    }
+    SECTION("Queries filter by size, period, and description text")
+    {
+        ScaleLibrary::Query query;
+        REQUIRE(library.find(query).size() == 3);
+
+        query.numNotes = 7;
+        REQUIRE(library.find(query).size() == 1);
+
+        query = ScaleLibrary::Query();
+        query.periodCents = 1200.0;
+        REQUIRE(library.find(query).size() == 2);
+        query.periodCents = 1902.0;
+        query.periodToleranceCents = 1.0;
+        REQUIRE(library.find(query).size() == 1);
+
+        query = ScaleLibrary::Query();
+        query.text = "GAMELAN pel";
+        std::vector<const ScaleLibrary::Entry*> results = library.find(query);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0]->description == "Pelog, gamelan tuning");
+        query.text = "tritave"; //matches the file name
+        REQUIRE(library.find(query).size() == 1);
+
+        query = ScaleLibrary::Query();
+        query.isKbm = true;
+        REQUIRE(library.find(query).size() == 1);
+        query = ScaleLibrary::Query();
+        query.includeInvalid = true;
+        REQUIRE(library.find(query).size() == 4);
+    }
+    SECTION("The same tuning has the same fingerprint")
+    {
+        REQUIRE(ScaleLibrary::makeFingerprint({1.5, 2.0}) == ScaleLibrary::makeFingerprint({1.50001, 2.0}));
+        REQUIRE(ScaleLibrary::makeFingerprint({1.5, 2.0}) != ScaleLibrary::makeFingerprint({2.0, 1.5}));
+    }
+    SECTION("Rescans only parse new and changed files")
+    {
+        REQUIRE(library.scan(directory) == 0);
+
+        juce::File pelogFile = directory.getChildFile("pelog.scl");
+        pelogFile.replaceWithText("Pelog, gamelan tuning\n6\n120.\n270.\n540.\n670.\n785.\n1200.\n");
+        pelogFile.setLastModificationTime(juce::Time::getCurrentTime() + juce::RelativeTime::seconds(10.0));
+        subdirectory.getChildFile("broken.scl").deleteFile();
+        REQUIRE(library.scan(directory) == 1);
+        REQUIRE(library.getNumEntries() == 4);
+        REQUIRE(library.getEntry(pelogFile.getFullPathName().toStdString())->numNotes == 6);
+    }
+    SECTION("A saved index is reused after a restart")
+    {
+        juce::File indexFile = directory.getSiblingFile(directory.getFileName() + "-index.xml");
+        REQUIRE(library.saveIndex(indexFile));
+
+        ScaleLibrary restarted;
+        REQUIRE(restarted.loadIndex(indexFile));
+        REQUIRE(restarted.getNumEntries() == 5);
+        REQUIRE(restarted.scan(directory) == 0);
+        ScaleLibrary::Query query;
+        query.text = "bohlen";
+        REQUIRE(restarted.find(query).size() == 1);
+        indexFile.deleteFile();
+    }
+
+    directory.deleteRecursively();
+}
@@ -0,0 +1,81 @@
+/*
+ ==============================================================================
+
+ TestScalePack.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/Scale.h"
+#include "../../MicroModulation/Source/ScalePack.h"
+
+TEST_CASE("ScalePack compiles Scala files into a memory mapped pack")
+{
+    juce::File directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("ScalePackTest", "");
+    REQUIRE(directory.createDirectory().wasOk());
+    REQUIRE(directory.getChildFile("maps").createDirectory().wasOk());
+    const char* pelogText = "Pelog\n7\n120.\n270.\n540.\n670.\n785.\n950.\n1200.\n";
+    directory.getChildFile("pelog.scl").replaceWithText(pelogText);
+    directory.getChildFile("fifth.scl").replaceWithText("Just fifth\n2\n3/2\n2/1\n");
+    directory.getChildFile("broken.scl").replaceWithText("Broken\n2\n3/2\n");
+    directory.getChildFile("maps").getChildFile("skip.kbm").replaceWithText("3\n0\n127\n60\n69\n440.0\n2\n0\nx\n1\n");
+    juce::File packFile = directory.getSiblingFile(directory.getFileName() + ".mmsp");
+
+    REQUIRE(ScalePack::build(directory, packFile) == 3); //the broken file is skipped
+
+    ScalePack::Ptr pack = ScalePack::open(packFile);
+    REQUIRE(pack != nullptr);
+    REQUIRE(pack->getNumEntries() == 3);
+
+    SECTION("Entries are found by name, and hold the parsed values")
+    {
+        REQUIRE(pack->findEntry("broken.scl") == -1);
+
+        int pelog = pack->findEntry("pelog.scl");
+        REQUIRE(pelog >= 0);
+        ScalePack::Entry entry = pack->getEntry(pelog);
+        REQUIRE(entry.description == "Pelog");
+        REQUIRE(entry.type == ScalePack::EntryType::scl);
+        REQUIRE(entry.numValues == 7);
+        REQUIRE(entry.values[6] == Catch::Approx(2.0));
+
+        int skip = pack->findEntry("maps/skip.kbm");
+        REQUIRE(skip >= 0);
+        scala::KbmData kbm = pack->getKbm(skip);
+        REQUIRE(kbm.isValid);
+        REQUIRE(kbm.formalOctaveScaleDegree == 1);
+        REQUIRE(kbm.mapping == std::vector<int>{0, -1, 1});
+        REQUIRE_FALSE(pack->getScl(skip).isValid);
+    }
+    SECTION("A Scale loads a pack entry the same as the text it was built from")
+    {
+        juce::UndoManager um;
+        Scale fromPack(um);
+        Scale fromText(um);
+        REQUIRE(fromPack.loadFromScalePack(*pack, pack->findEntry("pelog.scl")));
+        REQUIRE(fromText.loadSclString(pelogText));
+        REQUIRE(fromPack.getDescription() == fromText.getDescription());
+        REQUIRE(fromPack.getNotes() == fromText.getNotes());
+
+        REQUIRE(fromPack.loadFromScalePack(*pack, pack->findEntry("maps/skip.kbm")));
+        REQUIRE(fromPack.getKeyboardMap().getMapping().size() == 3);
+        REQUIRE(fromPack.getNotes().size() == 7); //loading a map keeps the scale
+        REQUIRE_FALSE(fromPack.loadFromScalePack(*pack, -1));
+    }
+    SECTION("Every user of a pack shares one mapping")
+    {
+        REQUIRE(ScalePack::open(packFile).get() == pack.get());
+    }
+    SECTION("Files that aren't packs are rejected")
+    {
+        REQUIRE(ScalePack::open(directory.getChildFile("pelog.scl")) == nullptr);
+    }
+
+    pack = nullptr;
+    packFile.deleteFile();
+    directory.deleteRecursively();
+}
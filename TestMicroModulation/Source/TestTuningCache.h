@@ -0,0 +1,112 @@
+/*
+ ==============================================================================
+
+ TestTuningCache.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <memory>
+#include <thread>
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/Scale.h"
+#include "../../MicroModulation/Source/TuningCache.h"
+#include "../../MicroModulation/Source/utils.h"
+
+TEST_CASE("Scales with the same tuning share one CompiledTuning")
+{
+    const std::string pelog = utils::makeSclString("Pelog", "7", {"120.", "270.", "540.", "670.", "785.", "950.", "1200."});
+    const int numTuningsBefore = TuningCache::getNumTunings();
+
+    juce::UndoManager um;
+    auto first = std::make_unique<Scale>(um);
+    auto second = std::make_unique<Scale>(um);
+    REQUIRE(first->loadSclString(pelog));
+    REQUIRE(second->loadSclString(pelog));
+    REQUIRE(&first->getCompiledTuning() == &second->getCompiledTuning());
+    REQUIRE(&first->getNotes() == &second->getNotes()); // the ValueTrees share the tuning's notes too
+
+    SECTION("Each Scale keeps its own modulation")
+    {
+        double pitch = second->getPitch(64);
+        first->modulate(60, 62);
+        REQUIRE(first->getPitch(64) != pitch);
+        REQUIRE(second->getPitch(64) == pitch);
+        REQUIRE(&first->getCompiledTuning() == &second->getCompiledTuning());
+    }
+    SECTION("Loading another tuning into one Scale leaves the other alone")
+    {
+        double pitch = second->getPitch(64);
+        REQUIRE(first->loadSclString(utils::makeSclString("12-TET", "1", {"100.0"})));
+        REQUIRE(&first->getCompiledTuning() != &second->getCompiledTuning());
+        REQUIRE(second->getPitch(64) == pitch);
+        REQUIRE(first->getPitch(64) == Catch::Approx(64.0));
+    }
+    SECTION("Tunings are dropped once no Scale uses them")
+    {
+        REQUIRE(TuningCache::getNumTunings() > numTuningsBefore);
+        first.reset();
+        second.reset();
+        REQUIRE(TuningCache::getNumTunings() == numTuningsBefore);
+    }
+    SECTION("The same text is only parsed once")
+    {
+        REQUIRE(TuningCache::parseScl(pelog) == TuningCache::parseScl(pelog));
+        // the formal octave is the 12th note, so the same text is only valid with a scale of at least 12 notes
+        const char* kbm = "12\n0\n127\n60\n69\n440.0\n12\n";
+        auto forTwelveNotes = TuningCache::parseKbm(kbm, 12);
+        auto forSevenNotes = TuningCache::parseKbm(kbm, 7);
+        REQUIRE(forTwelveNotes->isValid);
+        REQUIRE_FALSE(forSevenNotes->isValid);
+        REQUIRE(TuningCache::parseKbm(kbm, 12) == forTwelveNotes);
+        REQUIRE(TuningCache::parseKbm(kbm, 7) == forSevenNotes);
+    }
+}
+
+TEST_CASE("Loads and undos compile the tuning once")
+{
+    juce::UndoManager um;
+    Scale scale(um);
+    // a tuning no other test uses, so it is never found in the cache
+    const std::string scl = utils::makeSclString("Compile once", "3", {"111.1", "444.4", "1211.1"});
+    const std::string kbm = "3\n0\n127\n61\n69\n432.0\n2\n0\n1\n2\n";
+
+    int numCompiles = TuningCache::getNumCompiles();
+    REQUIRE(scale.loadSclString(scl));
+    REQUIRE(TuningCache::getNumCompiles() == numCompiles + 1);
+
+    numCompiles = TuningCache::getNumCompiles();
+    REQUIRE(scale.loadKbmString(kbm));
+    REQUIRE(TuningCache::getNumCompiles() == numCompiles + 1);
+    const double pitch = scale.getPitch(64);
+
+    numCompiles = TuningCache::getNumCompiles();
+    REQUIRE(scale.undo());
+    REQUIRE(TuningCache::getNumCompiles() <= numCompiles + 1); //the tuning before the .kbm may still be cached
+    REQUIRE(scale.getKeyboardMap().getMiddleNote() == 60);
+    REQUIRE(scale.getPitch(64) != Catch::Approx(pitch));
+
+    REQUIRE(scale.redo());
+    REQUIRE(scale.getKeyboardMap().getMiddleNote() == 61);
+    REQUIRE(scale.getPitch(64) == Catch::Approx(pitch));
+}
+
+TEST_CASE("Threads parsing the same text at once all get the same parse")
+{
+    std::vector<std::string> cents;
+    for(int i = 1; i <= 1000; i++) cents.push_back(std::to_string(i * 1.2)); // has a decimal point, so it is read as cents
+    const std::string scl = utils::makeSclString("1000 notes", "1000", cents);
+
+    std::shared_ptr<const scala::SclData> parses[4];
+    std::vector<std::thread> threads;
+    for(auto& parse : parses) threads.emplace_back([&parse, &scl] { parse = TuningCache::parseScl(scl); });
+    for(auto& thread : threads) thread.join();
+
+    REQUIRE(parses[0]->isValid);
+    for(const auto& parse : parses) REQUIRE(parse == parses[0]);
+    REQUIRE(TuningCache::parseScl(scl) == parses[0]);
+}
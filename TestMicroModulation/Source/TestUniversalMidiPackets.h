@@ -0,0 +1,90 @@
+/*
+ ==============================================================================
+
+ TestUniversalMidiPackets.h
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Catch/catch_amalgamated.hpp"
+//User-written Code
+#include "../../MicroModulation/Source/RetuneTable.h"
+#include "../../MicroModulation/Source/UniversalMidiPackets.h"
+
+TEST_CASE("Universal MIDI Packets are encoded correctly")
+{
+    juce::uint32 words[ump::maxWordsPerPacket];
+
+    SECTION("7 bit velocities are scaled up to 16 bits")
+    {
+        REQUIRE(ump::scaleUp7To16(0) == 0);
+        REQUIRE(ump::scaleUp7To16(64) == 0x8000);
+        REQUIRE(ump::scaleUp7To16(127) == 0xffff);
+    }
+    SECTION("Note ons carry the pitch attribute in 7.9 fixed point")
+    {
+        juce::uint32 pitch = RetuneTable::toFixedPitch(60.5);
+        REQUIRE(ump::writeNoteOnWithPitch(0, 1, 60, 64, pitch, words) == 2);
+        REQUIRE(words[0] == 0x40903c03u);
+        REQUIRE(words[1] == ((0x8000u << 16) | (60u << 9) | 256u));
+    }
+    SECTION("The rest of the pitch is sent as a per-note pitch bend")
+    {
+        REQUIRE(ump::getResidualPitchBend(RetuneTable::toFixedPitch(60.5), 2) == ump::centeredPitchBend);
+
+        juce::uint32 pitch = (60u << 25) + (1u << 15); // 1/1024 of a semitone above 60, which is too fine for 7.9
+        REQUIRE(pitch >> 16 == 60u << 9);
+        juce::uint32 bend = ump::getResidualPitchBend(pitch, 2);
+        REQUIRE((bend - ump::centeredPitchBend) / 2147483648.0 * 2.0 == Catch::Approx(1.0 / 1024.0));
+
+        REQUIRE(ump::writePerNotePitchBend(0, 16, 60, bend, words) == 2);
+        REQUIRE(words[0] == 0x406f3c00u);
+        REQUIRE(words[1] == bend);
+    }
+    SECTION("System messages get system packets, not MIDI 1.0 channel voice packets")
+    {
+        const juce::uint8 clock[] = {0xf8};
+        REQUIRE(ump::writeSystem(0, clock, 1, words) == 1);
+        REQUIRE(words[0] == 0x10f80000u);
+        const juce::uint8 songPosition[] = {0xf2, 0x10, 0x02};
+        REQUIRE(ump::writeSystem(3, songPosition, 3, words) == 1);
+        REQUIRE(words[0] == 0x13f21002u);
+    }
+    SECTION("The packet buffer drops packets instead of growing")
+    {
+        ump::PacketBuffer buffer;
+        buffer.ensureSize(1);
+        ump::writeNoteOff(0, 1, 60, 0, words);
+        REQUIRE(buffer.add(words, 2, 0));
+        REQUIRE_FALSE(buffer.add(words, 2, 1));
+        REQUIRE(buffer.getNumPackets() == 1);
+        buffer.clear();
+        REQUIRE(buffer.getNumPackets() == 0);
+    }
+}
+
+TEST_CASE("Benchmark UMP per-note pitch against MIDI 1.0 pitchbend", "[.][benchmark]")
+{
+    juce::uint32 pitches[RetuneTable::numMidiNotes];
+    for(int note = 0; note < RetuneTable::numMidiNotes; note++) pitches[note] = RetuneTable::toFixedPitch(note + 0.123);
+
+    BENCHMARK("MIDI 1.0: pitchbendToPitchwheelPos")
+    {
+        juce::uint32 sum = 0;
+        for(int note = 0; note < RetuneTable::numMidiNotes; note++) sum += RetuneTable::toPitchWheel(pitches[note], note, 2.0f);
+        return sum;
+    };
+    BENCHMARK("MIDI 2.0: note on with pitch attribute and per-note pitch bend")
+    {
+        juce::uint32 words[ump::maxWordsPerPacket];
+        juce::uint32 sum = 0;
+        for(int note = 0; note < RetuneTable::numMidiNotes; note++)
+        {
+            ump::writeNoteOnWithPitch(0, 1, note, 100, pitches[note], words);
+            sum += words[1] + ump::getResidualPitchBend(pitches[note], 2);
+        }
+        return sum;
+    };
+}